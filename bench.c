@@ -0,0 +1,461 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+
+#include "sha256.h"
+#include "hash.h"
+#include "dict.h"
+#include "rules.h"
+#include "mask.h"
+#include "markov.h"
+#include "emit.h"
+#include "modexp.h"
+
+// microbenchmarks of the hot paths, run by `make bench`. each is warmed up,
+// then timed BENCH_RUNS times, and reported as one JSON object a line with
+// the median and variance of the time per operation, so runs can be diffed
+// or fed to a script
+
+#define BENCH_WARMUP 2
+#define BENCH_RUNS   9
+
+#define DICT_FILE   "dict.txt"
+#define MARKOV_FILE "common_passwords.txt"
+#define LEN_PWD     6
+
+// the 2048 bit MODP group of RFC 3526, generator 2
+#define MODP_2048 "0xFFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74" \
+	"020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F14374FE1356D6D51C245" \
+	"E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7EDEE386BFB5A899FA5AE9F24117C4B1FE6" \
+	"49286651ECE45B3DC2007CB8A163BF0598DA48361C55D39A69163FA8FD24CF5F83655D23DCA3AD96" \
+	"1C62F356208552BB9ED529077096966D670C354E4ABC9804F1746C08CA18217C32905E462E36CE3B" \
+	"E39E772C180E86039B2783A2EC07A28FB5C55DF06F4C52C9DE2BCBF6955817183995497CEA956AE5" \
+	"15D2261898FA051015728E5A8AACAA68FFFFFFFFFFFFFFFF"
+// g^b for so many exponents at once
+#define MODEXP_BATCH 16
+
+// not in the header, as nothing else should call it
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[]);
+
+// runs one round of a benchmark, returning how many operations it did
+typedef long (*BenchRun)(void *arg);
+
+// keeps results alive so the work making them is not optimised away
+static volatile unsigned long sink;
+
+static void bench(const char *name, BenchRun run, void *arg);
+static double now(void);
+static int compare_doubles(const void *a, const void *b);
+static void pin(void);
+
+static long bench_transform(void *arg);
+static long bench_init_update_final(void *arg);
+static long bench_short(void *arg);
+static long bench_batch(void *arg);
+static long bench_batch_early(void *arg);
+static long bench_check(void *arg);
+static long bench_rules(void *arg);
+static long bench_next_set(void *arg);
+static long bench_mask_odometer(void *arg);
+static long bench_markov(void *arg);
+static long bench_emit(void *arg);
+static long bench_dict(void *arg);
+static long bench_modexp_pow(void *arg);
+static long bench_modexp_fixed(void *arg);
+static long bench_modexp_batch(void *arg);
+
+// a batch of guesses like the ones the brute force makes
+static Batch guesses;
+
+int main(int argc, char *argv[]) {
+	pin();
+
+	guesses.count = BATCH_SIZE;
+	for (int i = 0; i < BATCH_SIZE; i++) {
+		for (int j = 0; j < LEN_PWD; j++) {
+			guesses.words[i * BATCH_WORD_MAX + j] = 'a' + (i * 7 + j * 13) % 26;
+		}
+		guesses.len[i] = LEN_PWD;
+	}
+
+	bench("sha256_transform", bench_transform, NULL);
+	bench("sha256_init_update_final", bench_init_update_final, NULL);
+	bench("sha256_short", bench_short, NULL);
+	bench("sha256_batch", bench_batch, NULL);
+	bench("sha256_batch_early", bench_batch_early, NULL);
+
+	// checking against random targets, which nothing will crack
+	int counts[] = { 1, 30, 1000, 100000 };
+	for (int c = 0; c < (int) (sizeof(counts) / sizeof(counts[0])); c++) {
+		char filename[] = "/tmp/crack_benchXXXXXX";
+		int fd = mkstemp(filename);
+		assert(fd >= 0);
+		FILE *fp = fdopen(fd, "wb");
+		assert(fp);
+		srand(c + 1);
+		for (int i = 0; i < counts[c] * SHA256_BLOCK_SIZE; i++) {
+			fputc(rand() & 0xff, fp);
+		}
+		fclose(fp);
+
+		Hash hash;
+		int any_len = 0;
+		char *filenames[] = { filename };
+		hash_init(&hash, filenames, &any_len, 1);
+		unlink(filename);
+
+		char name[64];
+		sprintf(name, "check_batch_%d_targets", counts[c]);
+		bench(name, bench_check, &hash);
+		hash_free(&hash);
+	}
+
+	Dict dict;
+	if (access(DICT_FILE, R_OK) == 0) {
+		bench("dict_init", bench_dict, NULL);
+
+		Rules rules;
+		rules_init(&rules);
+		int err = rules_compile(&rules, "=aA@\n=eE3\n=iI1!\n=oO0\n=sS5$\n:\nc\n$1\n>5 '6 %3\n");
+		assert(!err);
+		dict_init(&dict, DICT_FILE);
+		void *args[] = { &rules, &dict };
+		bench("rules_apply", bench_rules, args);
+		dict_free(&dict);
+		rules_free(&rules);
+	}
+
+	// the generators crack's set and mask phases run
+	bench("next_set", bench_next_set, NULL);
+	Mask mask;
+	int err = mask_compile(&mask, "?l?l?l?l?d?d", NULL);
+	assert(!err);
+	bench("mask_odometer", bench_mask_odometer, &mask);
+
+	Markov *markov = malloc(sizeof(Markov));
+	assert(markov);
+	if (markov_train(markov, MARKOV_FILE, LEN_PWD) == 0) {
+		bench("markov_level", bench_markov, markov);
+	}
+	free(markov);
+
+	int fd = open("/dev/null", O_WRONLY);
+	assert(fd >= 0);
+	bench("emit_word", bench_emit, &fd);
+	close(fd);
+
+	// g^b for a one limb modulus, and the 2048 bit group by each path
+	const char *moduli[] = { "0xffffffffffffffc5", MODP_2048 };
+	const char *names[] = { "64", "2048" };
+	for (int m = 0; m < 2; m++) {
+		Modexp *mod = malloc(sizeof(Modexp));
+		assert(mod);
+		int limbs = modexp_limbs(moduli[m]);
+		Limb n[MODEXP_LIMBS_MAX], g[MODEXP_LIMBS_MAX] = { 2 };
+		modexp_parse(n, limbs, moduli[m]);
+		int err = modexp_init(mod, n, limbs);
+		assert(!err);
+
+		FixedBase fixed;
+		modexp_fixed_init(&fixed, mod, g, limbs * 64);
+
+		char name[64];
+		sprintf(name, "modexp_pow_%s", names[m]);
+		bench(name, bench_modexp_pow, &fixed);
+		sprintf(name, "modexp_fixed_pow_%s", names[m]);
+		bench(name, bench_modexp_fixed, &fixed);
+		sprintf(name, "modexp_fixed_batch_%s", names[m]);
+		bench(name, bench_modexp_batch, &fixed);
+
+		modexp_fixed_free(&fixed);
+		free(mod);
+	}
+
+	return 0;
+}
+
+static void bench(const char *name, BenchRun run, void *arg) {
+	double times[BENCH_RUNS];
+	long ops = 0;
+
+	for (int i = 0; i < BENCH_WARMUP; i++) {
+		run(arg);
+	}
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		double start = now();
+		ops = run(arg);
+		times[i] = (now() - start) * 1e9 / ops;
+	}
+
+	double mean = 0, variance = 0;
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		mean += times[i] / BENCH_RUNS;
+	}
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		variance += (times[i] - mean) * (times[i] - mean) / (BENCH_RUNS - 1);
+	}
+	qsort(times, BENCH_RUNS, sizeof(double), compare_doubles);
+	double median = times[BENCH_RUNS / 2];
+
+	printf("{\"name\": \"%s\", \"ops\": %ld, \"runs\": %d, \"ns_per_op\": %.3f, "
+	       "\"variance\": %.5f, \"min\": %.3f, \"max\": %.3f, \"mops_per_s\": %.2f}\n",
+	       name, ops, BENCH_RUNS, median, variance, times[0], times[BENCH_RUNS - 1], 1e3 / median);
+	fflush(stdout);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+// keeps to one cpu, so timings are not spread over whichever the scheduler
+// picks
+static void pin(void) {
+	cpu_set_t cpus;
+	if (sched_getaffinity(0, sizeof(cpus), &cpus) < 0) {
+		return;
+	}
+	for (int i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET(i, &cpus)) {
+			CPU_ZERO(&cpus);
+			CPU_SET(i, &cpus);
+			sched_setaffinity(0, sizeof(cpus), &cpus);
+			return;
+		}
+	}
+}
+
+static long bench_transform(void *arg) {
+	SHA256_CTX ctx;
+	BYTE block[64] = { 0 };
+	sha256_init(&ctx);
+
+	long n = 1 << 20;
+	for (long i = 0; i < n; i++) {
+		block[0] = i;
+		sha256_transform(&ctx, block);
+	}
+	sink += ctx.state[0];
+	return n;
+}
+
+static long bench_init_update_final(void *arg) {
+	BYTE hash[SHA256_BLOCK_SIZE];
+	BYTE word[LEN_PWD] = "aaaaaa";
+
+	long n = 1 << 19;
+	for (long i = 0; i < n; i++) {
+		SHA256_CTX ctx;
+		word[0] = 'a' + i % 26;
+		sha256_init(&ctx);
+		sha256_update(&ctx, word, LEN_PWD);
+		sha256_final(&ctx, hash);
+		sink += hash[0];
+	}
+	return n;
+}
+
+static long bench_short(void *arg) {
+	BYTE hash[SHA256_BLOCK_SIZE];
+	BYTE word[LEN_PWD] = "aaaaaa";
+
+	long n = 1 << 20;
+	for (long i = 0; i < n; i++) {
+		word[0] = 'a' + i % 26;
+		sha256_short(word, LEN_PWD, hash);
+		sink += hash[0];
+	}
+	return n;
+}
+
+static long bench_batch(void *arg) {
+	BYTE hashes[BATCH_SIZE * SHA256_BLOCK_SIZE];
+
+	long n = 1 << 12;
+	for (long i = 0; i < n; i++) {
+		guesses.words[0] = 'a' + i % 26;
+		sha256_batch((BYTE *) guesses.words, BATCH_WORD_MAX, guesses.len, BATCH_SIZE, hashes);
+		sink += hashes[0];
+	}
+	return n * BATCH_SIZE;
+}
+
+static long bench_batch_early(void *arg) {
+	WORD early[BATCH_SIZE];
+
+	long n = 1 << 12;
+	for (long i = 0; i < n; i++) {
+		guesses.words[0] = 'a' + i % 26;
+		sha256_batch_early((BYTE *) guesses.words, BATCH_WORD_MAX, guesses.len, BATCH_SIZE, early);
+		sink += early[0];
+	}
+	return n * BATCH_SIZE;
+}
+
+static long bench_check(void *arg) {
+	long n = 1 << 12;
+	for (long i = 0; i < n; i++) {
+		guesses.words[0] = 'a' + i % 26;
+		check_batch(arg, &guesses);
+	}
+	return n * BATCH_SIZE;
+}
+
+static int count_guess(void *arg, const char *word, int len) {
+	(*(long *) arg)++;
+	sink += word[0];
+	return 1;
+}
+
+static long bench_rules(void *arg) {
+	Rules *rules = ((void **) arg)[0];
+	Dict *dict = ((void **) arg)[1];
+
+	long made = 0;
+	for (long i = 0; i < dict->count; i++) {
+		int len;
+		const char *word = dict_word(dict, i, &len);
+		rules_apply(rules, word, len, count_guess, &made);
+	}
+	return made > 0 ? made : 1;
+}
+
+static long bench_next_set(void *arg) {
+	const char *set = "abcdefghijklmnopqrstuvwxyz0123456789";
+	char word[LEN_PWD] = "aaaaaa";
+	int index[LEN_PWD] = { 0 };
+
+	// the last few characters run through the set, as after a short word
+	long n = 1 << 22;
+	for (long i = 0; i < n; i++) {
+		int changed = next_set(word, index, 2, LEN_PWD, set, strlen(set));
+		sink += word[changed < 0 ? 0 : changed];
+	}
+	return n;
+}
+
+static long bench_mask_odometer(void *arg) {
+	Mask *mask = arg;
+	char word[MASK_LEN_MAX];
+	int index[MASK_LEN_MAX] = { 0 }, last = mask->len - 1;
+	for (int i = 0; i < mask->len; i++) {
+		word[i] = mask->set[i][0];
+	}
+
+	// as guess_mask_unit runs it, a unit fixing the first character
+	long made = 0;
+	while (made < 1 << 22) {
+		for (int c = 0; c < mask->radix[last]; c++) {
+			word[last] = mask->set[last][c];
+			sink += word[last];
+		}
+		made += mask->radix[last];
+		if (mask_carry(mask, word, index, 1) < 0) {
+			index[0] = (index[0] + 1) % mask->radix[0];
+			word[0] = mask->set[0][index[0]];
+		}
+	}
+	return made;
+}
+
+static long bench_markov(void *arg) {
+	Markov *markov = arg;
+	char word[MARKOV_LEN_MAX];
+	int index[MARKOV_LEN_MAX];
+
+	// the likeliest levels, until there have been enough words
+	long made = 0;
+	for (int level = markov_least(markov); made < 1 << 20 && level <= markov_most(markov); level++) {
+		for (int first = 0; first < MARKOV_CHARS; first++) {
+			markov_level(markov, level, first, NULL, word, index, count_guess, &made);
+		}
+	}
+	return made > 0 ? made : 1;
+}
+
+static long bench_emit(void *arg) {
+	Emit emit;
+	emit_init(&emit, *(int *) arg, 1, -1);
+	emit_phase(&emit, 1);
+	emit_claim(&emit, 0);
+
+	long n = 1 << 22;
+	char word[LEN_PWD] = "aaaaaa";
+	for (long i = 0; i < n; i++) {
+		word[0] = 'a' + i % 26;
+		emit_word(&emit, 0, word, LEN_PWD);
+	}
+	emit_end(&emit, 0);
+	emit_free(&emit);
+	return n;
+}
+
+static long bench_dict(void *arg) {
+	Dict dict;
+	dict_init(&dict, DICT_FILE);
+	long n = dict.count;
+	dict_free(&dict);
+	return n > 0 ? n : 1;
+}
+
+// exponents the length of the modulus, varying from call to call
+static void random_exponents(Limb *exps, int limbs, int n) {
+	for (int i = 0; i < n * limbs; i++) {
+		exps[i] = (Limb) rand() << 42 ^ (Limb) rand() << 21 ^ rand();
+	}
+}
+
+static long bench_modexp_pow(void *arg) {
+	FixedBase *fixed = arg;
+	int limbs = fixed->mod->limbs;
+	Limb exp[MODEXP_LIMBS_MAX], out[MODEXP_LIMBS_MAX];
+
+	long n = limbs > 1 ? 1 << 6 : 1 << 16;
+	for (long i = 0; i < n; i++) {
+		random_exponents(exp, limbs, 1);
+		modexp_pow(fixed->mod, out, fixed->g, exp, limbs);
+		sink += out[0];
+	}
+	return n;
+}
+
+static long bench_modexp_fixed(void *arg) {
+	FixedBase *fixed = arg;
+	int limbs = fixed->mod->limbs;
+	Limb exp[MODEXP_LIMBS_MAX], out[MODEXP_LIMBS_MAX];
+
+	long n = limbs > 1 ? 1 << 8 : 1 << 18;
+	for (long i = 0; i < n; i++) {
+		random_exponents(exp, limbs, 1);
+		modexp_fixed_pow(fixed, out, exp, limbs);
+		sink += out[0];
+	}
+	return n;
+}
+
+static long bench_modexp_batch(void *arg) {
+	FixedBase *fixed = arg;
+	int limbs = fixed->mod->limbs;
+	Limb exps[MODEXP_BATCH * MODEXP_LIMBS_MAX], out[MODEXP_BATCH * MODEXP_LIMBS_MAX];
+
+	long n = limbs > 1 ? 1 << 4 : 1 << 14;
+	for (long i = 0; i < n; i++) {
+		random_exponents(exps, limbs, MODEXP_BATCH);
+		modexp_fixed_batch(fixed, out, exps, limbs, MODEXP_BATCH);
+		sink += out[0];
+	}
+	return n * MODEXP_BATCH;
+}
@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "checkpoint.h"
+
+#define LINE_MAX_LEN 256
+
+static void *checkpoint_thread(void *arg);
+static void checkpoint_write(Checkpoint *ck, FILE *fp);
+static void checkpoint_write_found(Checkpoint *ck, FILE *fp);
+
+void checkpoint_init(Checkpoint *ck, char *filename, int workers, int targets, int word_len) {
+	assert(word_len <= CHECKPOINT_WORD_MAX);
+
+	ck->filename = filename;
+	ck->word_len = word_len;
+
+	ck->phase = -1;
+	ck->units = 0;
+	ck->done = NULL;
+	ck->workers = workers;
+	ck->slots = malloc(sizeof(CheckpointSlot) * workers);
+	assert(ck->slots);
+	for (int i = 0; i < workers; i++) {
+		ck->slots[i].unit = -1;
+	}
+
+	ck->resume_phase = -1;
+	ck->resume_units = 0;
+	ck->resume_done = NULL;
+	ck->resume = NULL;
+	ck->n_resume = 0;
+
+	ck->targets = targets;
+	ck->found = calloc(targets > 0 ? targets : 1, sizeof(char));
+	assert(ck->found);
+
+	ck->drain = NULL;
+	ck->drain_arg = NULL;
+
+	ck->interval = 0;
+	ck->stop = 0;
+	pthread_mutex_init(&ck->lock, NULL);
+	pthread_cond_init(&ck->wake, NULL);
+}
+
+void checkpoint_free(Checkpoint *ck) {
+	if (ck->interval > 0) {
+		pthread_mutex_lock(&ck->lock);
+		ck->stop = 1;
+		pthread_cond_signal(&ck->wake);
+		pthread_mutex_unlock(&ck->lock);
+		pthread_join(ck->thread, NULL);
+	}
+
+	checkpoint_save(ck);
+
+	pthread_mutex_destroy(&ck->lock);
+	pthread_cond_destroy(&ck->wake);
+
+	free(ck->done);
+	free(ck->slots);
+	free(ck->resume_done);
+	free(ck->resume);
+	free(ck->found);
+}
+
+int checkpoint_load(Checkpoint *ck) {
+	FILE *fp = fopen(ck->filename, "r");
+	if (!fp) {
+		return 0;
+	}
+
+	char line[LINE_MAX_LEN];
+	int targets, word_len;
+	if (!fgets(line, LINE_MAX_LEN, fp)
+	    || sscanf(line, "checkpoint %d %d", &targets, &word_len) != 2
+	    || targets != ck->targets || word_len != ck->word_len) {
+		fclose(fp);
+		return 0;
+	}
+
+	int alloc = 0;
+	while (fgets(line, LINE_MAX_LEN, fp)) {
+		long from, to;
+		int target;
+
+		if (sscanf(line, "phase %d %ld", &ck->resume_phase, &ck->resume_units) == 2) {
+			free(ck->resume_done);
+			ck->resume_done = calloc(ck->resume_units > 0 ? ck->resume_units : 1, sizeof(char));
+			assert(ck->resume_done);
+		} else if (sscanf(line, "done %ld %ld", &from, &to) == 2) {
+			for (long u = from; ck->resume_done && u < to && u < ck->resume_units; u++) {
+				ck->resume_done[u] = 1;
+			}
+		} else if (!strncmp(line, "at ", 3)) {
+			if (ck->n_resume >= alloc) {
+				alloc = alloc ? alloc * 2 : 8;
+				ck->resume = realloc(ck->resume, sizeof(CheckpointSlot) * alloc);
+				assert(ck->resume);
+			}
+
+			// the unit, then the odometer if there was one worth saving
+			CheckpointSlot *slot = &ck->resume[ck->n_resume++];
+			char *p = line + 3, *end;
+			slot->unit = strtol(p, &end, 10);
+			slot->saved = 1;
+			for (int i = 0; i < ck->word_len; i++) {
+				p = end;
+				slot->index[i] = strtol(p, &end, 10);
+				if (end == p) {
+					slot->saved = 0;
+					break;
+				}
+			}
+		} else if (sscanf(line, "found %d", &target) == 1) {
+			if (target >= 0 && target < ck->targets) {
+				ck->found[target] = 1;
+			}
+		}
+	}
+
+	fclose(fp);
+
+	return 1;
+}
+
+void checkpoint_start(Checkpoint *ck, int interval) {
+	ck->interval = interval;
+	int err = pthread_create(&ck->thread, NULL, checkpoint_thread, ck);
+	assert(!err);
+}
+
+// snapshots everything, then writes it to a temporary file which is renamed
+// over the last checkpoint, so a crash part way leaves the old one intact.
+// targets found are taken after the drain, as the batches it waits on can
+// crack targets in units the snapshot already counts as done
+void checkpoint_save(Checkpoint *ck) {
+	char *snapshot;
+	size_t len;
+	FILE *mem = open_memstream(&snapshot, &len);
+	assert(mem);
+
+	pthread_mutex_lock(&ck->lock);
+	int started = ck->phase >= 0;
+	if (started) {
+		checkpoint_write(ck, mem);
+	}
+	pthread_mutex_unlock(&ck->lock);
+
+	if (!started) {
+		fclose(mem);
+		free(snapshot);
+		return;
+	}
+
+	if (ck->drain) {
+		ck->drain(ck->drain_arg);
+	}
+
+	pthread_mutex_lock(&ck->lock);
+	checkpoint_write_found(ck, mem);
+	pthread_mutex_unlock(&ck->lock);
+	fclose(mem);
+
+	char tmp[LINE_MAX_LEN];
+	snprintf(tmp, LINE_MAX_LEN, "%s.tmp", ck->filename);
+
+	FILE *fp = fopen(tmp, "w");
+	if (!fp) {
+		perror(tmp);
+		free(snapshot);
+		return;
+	}
+
+	fwrite(snapshot, sizeof(char), len, fp);
+	fflush(fp);
+	fsync(fileno(fp));
+	fclose(fp);
+	free(snapshot);
+
+	if (rename(tmp, ck->filename) < 0) {
+		perror(ck->filename);
+	}
+}
+
+int checkpoint_phase(Checkpoint *ck, int phase, long units) {
+	pthread_mutex_lock(&ck->lock);
+
+	if (phase < ck->resume_phase) {
+		pthread_mutex_unlock(&ck->lock);
+		return 0;
+	}
+
+	ck->phase = phase;
+	ck->units = units;
+	free(ck->done);
+	ck->done = calloc(units > 0 ? units : 1, sizeof(char));
+	assert(ck->done);
+
+	// only the phase the last run stopped in has units to pick up
+	if (phase == ck->resume_phase && units == ck->resume_units) {
+		memcpy(ck->done, ck->resume_done, units);
+	} else {
+		ck->n_resume = 0;
+	}
+
+	for (int i = 0; i < ck->workers; i++) {
+		ck->slots[i].unit = -1;
+	}
+
+	pthread_mutex_unlock(&ck->lock);
+
+	return 1;
+}
+
+int checkpoint_begin(Checkpoint *ck, int worker, long unit, int index[]) {
+	int resumed = 0;
+
+	pthread_mutex_lock(&ck->lock);
+
+	if (ck->done[unit]) {
+		pthread_mutex_unlock(&ck->lock);
+		return -1;
+	}
+
+	CheckpointSlot *slot = &ck->slots[worker];
+	slot->unit = unit;
+	slot->saved = 0;
+
+	for (int i = 0; i < ck->n_resume; i++) {
+		if (ck->resume[i].unit == unit) {
+			if (ck->resume[i].saved) {
+				memcpy(index, ck->resume[i].index, sizeof(int) * ck->word_len);
+				*slot = ck->resume[i];
+				resumed = 1;
+			}
+			// it is this run's to save from now on
+			ck->resume[i].unit = -1;
+		}
+	}
+
+	pthread_mutex_unlock(&ck->lock);
+
+	return resumed;
+}
+
+void checkpoint_progress(Checkpoint *ck, int worker, const int index[]) {
+	pthread_mutex_lock(&ck->lock);
+	CheckpointSlot *slot = &ck->slots[worker];
+	memcpy(slot->index, index, sizeof(int) * ck->word_len);
+	slot->saved = 1;
+	pthread_mutex_unlock(&ck->lock);
+}
+
+void checkpoint_end(Checkpoint *ck, int worker) {
+	pthread_mutex_lock(&ck->lock);
+	CheckpointSlot *slot = &ck->slots[worker];
+	ck->done[slot->unit] = 1;
+	slot->unit = -1;
+	pthread_mutex_unlock(&ck->lock);
+}
+
+void checkpoint_found(Checkpoint *ck, int target) {
+	pthread_mutex_lock(&ck->lock);
+	ck->found[target] = 1;
+	pthread_mutex_unlock(&ck->lock);
+}
+
+static void *checkpoint_thread(void *arg) {
+	Checkpoint *ck = arg;
+
+	pthread_mutex_lock(&ck->lock);
+	while (!ck->stop) {
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += ck->interval;
+
+		pthread_cond_timedwait(&ck->wake, &ck->lock, &until);
+		if (!ck->stop) {
+			pthread_mutex_unlock(&ck->lock);
+			checkpoint_save(ck);
+			pthread_mutex_lock(&ck->lock);
+		}
+	}
+	pthread_mutex_unlock(&ck->lock);
+
+	return NULL;
+}
+
+// writes the state out to fp. call with the lock held
+static void checkpoint_write(Checkpoint *ck, FILE *fp) {
+	fprintf(fp, "checkpoint %d %d\n", ck->targets, ck->word_len);
+	fprintf(fp, "phase %d %ld\n", ck->phase, ck->units);
+
+	// runs of finished units
+	for (long u = 0; u < ck->units; u++) {
+		if (ck->done[u]) {
+			long from = u;
+			while (u < ck->units && ck->done[u]) {
+				u++;
+			}
+			fprintf(fp, "done %ld %ld\n", from, u);
+		}
+	}
+
+	// units part way through, in this run or one still left from the last
+	for (int i = 0; i < ck->workers + ck->n_resume; i++) {
+		CheckpointSlot *slot = i < ck->workers ? &ck->slots[i] : &ck->resume[i - ck->workers];
+		if (slot->unit < 0) {
+			continue;
+		}
+
+		fprintf(fp, "at %ld", slot->unit);
+		for (int j = 0; slot->saved && j < ck->word_len; j++) {
+			fprintf(fp, " %d", slot->index[j]);
+		}
+		fprintf(fp, "\n");
+	}
+}
+
+static void checkpoint_write_found(Checkpoint *ck, FILE *fp) {
+	for (int i = 0; i < ck->targets; i++) {
+		if (ck->found[i]) {
+			fprintf(fp, "found %d\n", i);
+		}
+	}
+}
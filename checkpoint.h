@@ -0,0 +1,73 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <pthread.h>
+
+// longest odometer a checkpoint can hold
+#define CHECKPOINT_WORD_MAX 16
+
+// what a worker is part way through
+typedef struct {
+	long unit;      // -1 when not in a unit
+	int saved;      // whether index holds the next word to try
+	int index[CHECKPOINT_WORD_MAX];
+} CheckpointSlot;
+
+typedef struct {
+	char *filename;
+	int word_len;
+
+	// progress through the current phase
+	int phase;
+	long units;
+	char *done;
+	CheckpointSlot *slots;
+	int workers;
+
+	// where the run being resumed stopped, if anywhere
+	int resume_phase;
+	long resume_units;
+	char *resume_done;
+	CheckpointSlot *resume;
+	int n_resume;
+
+	char *found;
+	int targets;
+
+	// called between taking a snapshot and writing it out, to wait for work
+	// already counted in the snapshot to really be done
+	void (*drain)(void *arg);
+	void *drain_arg;
+
+	int interval, stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} Checkpoint;
+
+// sets up checkpointing to filename for a run of workers against targets
+// hashes, with odometers word_len long
+void checkpoint_init(Checkpoint *ck, char *filename, int workers, int targets, int word_len);
+// stops the writer, saving a final checkpoint
+void checkpoint_free(Checkpoint *ck);
+
+// reads the checkpoint left by a previous run, returning 0 if there is none
+// or it was for a different set of targets
+int checkpoint_load(Checkpoint *ck);
+// writes the checkpoint every interval seconds until checkpoint_free
+void checkpoint_start(Checkpoint *ck, int interval);
+// atomically replaces the checkpoint file with the current state
+void checkpoint_save(Checkpoint *ck);
+
+// moves on to phase, split into units. returns 0 if the run being resumed
+// had already finished the phase
+int checkpoint_phase(Checkpoint *ck, int phase, long units);
+// claims unit for worker. returns -1 if it was already done, 1 if index has
+// been filled in with where to pick the unit back up, else 0
+int checkpoint_begin(Checkpoint *ck, int worker, long unit, int index[]);
+// records that worker has tried every word before index in its unit
+void checkpoint_progress(Checkpoint *ck, int worker, const int index[]);
+void checkpoint_end(Checkpoint *ck, int worker);
+void checkpoint_found(Checkpoint *ck, int target);
+
+#endif
@@ -1,100 +1,560 @@
 
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "modexp.h"
+#include "line.h"
+
 #define SERVER_IP   "172.26.37.44"
 #define SERVER_PORT 7800
 
 #define USERNAME "barnesj2"
-#define G        15
-#define P        97
+// the group, unless others are given
+#define G        "15"
+#define P        "97"
+
+#define BUFF_SIZE LINE_SIZE
+
+// events taken from epoll at a time
+#define EVENTS_MAX 256
+// longest username the stand-in server keeps
+#define USER_MAX   64
 
-#define BUFF_SIZE 1024
+// the group both ends work in, and the powers of its generator
+typedef struct {
+	int limbs;
+	Modexp mod;
+	FixedBase fixed;
+} Group;
 
-int mod_exp(int base, int exp, int mod);
+// what a session is waiting on next, server side then client side
+enum { AWAIT_USER, AWAIT_G_B, AWAIT_G_AB, AWAIT_G_A, AWAIT_MESSAGE, DONE };
+
+// one handshake over a non blocking socket
+typedef struct {
+	Line line;
+	int stage;
+	// whether epoll is waiting to write as well as read
+	int writing;
+	// this end's secret exponent, and the secret both should end up with
+	Limb secret[MODEXP_LIMBS_MAX], shared[MODEXP_LIMBS_MAX];
+	char user[USER_MAX];
+	double start;
+} Session;
+
+void group_init(Group *group, const char *p_str, const char *g_str);
+void group_free(Group *group);
+void handshake(Group *group, const char *b_str);
+void serve(Group *group, int port);
+int serve_event(Group *group, Session *session, int events);
+void load(Group *group, const char *host, const char *port, long sessions, int concurrent);
+int load_start(Group *group, Session *session, int epfd, struct sockaddr *addr, socklen_t addr_len);
+int load_event(Group *group, Session *session, int events);
+void report(double *latencies, long done, long failed, double elapsed);
+void watch(int epfd, Session *session);
+void send_line(Line *line, const char *str);
+int receive_line(Line *line, char *buff);
+void random_exponent(Group *group, Limb *out);
+void raise_fd_limit(void);
+double now(void);
+int compare_doubles(const void *a, const void *b);
+void parse_number(Limb *out, int limbs, const char *str, const char *name);
 void check_error(int err, char *str);
 int setup(struct sockaddr_in *serv_addr);
 
 int main(int argc, char *argv[]) {
-	if (argc != 2) {
-		fprintf(stderr, "USAGE: <program> <b : hex>\n");
+	Group group;
+
+	if (argc == 2 || (argc == 4 && argv[1][0] != '-')) {
+		group_init(&group, argc == 4 ? argv[2] : P, argc == 4 ? argv[3] : G);
+		handshake(&group, argv[1]);
+	} else if ((argc == 3 || argc == 5) && strcmp(argv[1], "--serve") == 0) {
+		group_init(&group, argc == 5 ? argv[3] : P, argc == 5 ? argv[4] : G);
+		serve(&group, atoi(argv[2]));
+	} else if ((argc == 6 || argc == 8) && strcmp(argv[1], "--load") == 0 && atol(argv[4]) > 0 &&
+	           atoi(argv[5]) > 0) {
+		group_init(&group, argc == 8 ? argv[6] : P, argc == 8 ? argv[7] : G);
+		load(&group, argv[2], argv[3], atol(argv[4]), atoi(argv[5]));
+	} else {
+		fprintf(stderr, "USAGE: <program> <b> [<p> <g>]\n"
+		                "       <program> --serve <port> [<p> <g>]\n"
+		                "       <program> --load <host> <port> <sessions> <concurrent> [<p> <g>]\n");
 		exit(EXIT_FAILURE);
 	}
 
+	group_free(&group);
+
+	exit(EXIT_SUCCESS);
+}
+
+void group_init(Group *group, const char *p_str, const char *g_str) {
+	Limb p[MODEXP_LIMBS_MAX], g[MODEXP_LIMBS_MAX];
+
+	group->limbs = modexp_limbs(p_str);
+	parse_number(p, group->limbs, p_str, "p");
+	parse_number(g, group->limbs, g_str, "g");
+
+	if (modexp_init(&group->mod, p, group->limbs) < 0) {
+		fprintf(stderr, "ERROR, p must be odd and at least 3\n");
+		exit(EXIT_FAILURE);
+	}
+	// g^b is always to the same base, so its powers can be worked out first
+	modexp_fixed_init(&group->fixed, &group->mod, g, group->limbs * 64);
+}
+
+void group_free(Group *group) {
+	modexp_fixed_free(&group->fixed);
+}
+
+// one handshake with the server, printing each step
+void handshake(Group *group, const char *b_str) {
+	int limbs = group->limbs;
+	Limb b[MODEXP_LIMBS_MAX];
+	parse_number(b, limbs, b_str, "b");
+
 	struct sockaddr_in serv_addr;
 	int sockfd = setup(&serv_addr);
+	Line line;
+	line_init(&line, sockfd);
 
 	char buff[BUFF_SIZE];
 
 	// write USERNAME to server
-	int len = printf("user =\t%s\n", USERNAME);
-	len = sprintf(buff, "%s\n", USERNAME);
-	check_error(write(sockfd, buff, len), "write");
+	printf("user =\t%s\n", USERNAME);
+	send_line(&line, USERNAME);
 
-	// get the first byte (in decimal) from the progargs
-	int b = atoi(argv[1]);
-	printf("b    =\t%d\n", b);
+	modexp_format(buff, BUFF_SIZE, b, limbs);
+	printf("b    =\t%s\n", buff);
 
-	int g_b = mod_exp(G, b, P);
-	printf("g^b  =\t%d\n", g_b);
+	Limb g_b[MODEXP_LIMBS_MAX];
+	modexp_fixed_pow(&group->fixed, g_b, b, limbs);
+	modexp_format(buff, BUFF_SIZE, g_b, limbs);
+	printf("g^b  =\t%s\n", buff);
 
 	// write G ^ b (mod P)
-	len = sprintf(buff, "%d\n", g_b);
-	check_error(write(sockfd, buff, len), "write");
+	send_line(&line, buff);
 
 	// read G ^ a (mod P)
-	memset(buff, 0, BUFF_SIZE);
-	check_error(read(sockfd, buff, BUFF_SIZE), "read");
-	int g_a = atoi(buff);
-	printf("g^a  =\t%d\n", g_a);
+	if (receive_line(&line, buff) < 0) {
+		fprintf(stderr, "ERROR, server closed before g^a\n");
+		exit(EXIT_FAILURE);
+	}
+	Limb g_a[MODEXP_LIMBS_MAX];
+	parse_number(g_a, limbs, buff, "g^a");
+	printf("g^a  =\t%s\n", buff);
 
-	int g_ab = mod_exp(g_a, b, P);
-	printf("g^ab =\t%d\n", g_ab);
+	Limb g_ab[MODEXP_LIMBS_MAX];
+	modexp_pow(&group->mod, g_ab, g_a, b, limbs);
+	modexp_format(buff, BUFF_SIZE, g_ab, limbs);
+	printf("g^ab =\t%s\n", buff);
 
 	// write G ^ (ab) (mod P)
-	len = sprintf(buff, "%d\n", g_ab);
-	check_error(write(sockfd, buff, len), "write");
+	send_line(&line, buff);
 
 	// recieve message
-	memset(buff, 0, BUFF_SIZE);
-	len = read(sockfd, buff, BUFF_SIZE);
-	check_error(len, "read");
-	printf("RECIEVED: %d\n\t%s\n", len, buff);
+	int len = receive_line(&line, buff);
+	printf("RECIEVED: %d\n\t%s\n", len < 0 ? 0 : len, len < 0 ? "" : buff);
 
 	// all done
 	close(sockfd);
+}
 
-	exit(EXIT_SUCCESS);
+// a stand-in for the server on port of localhost, taking handshakes until
+// killed. each gets a fresh a, and the message only if g^ab is right
+void serve(Group *group, int port) {
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+
+	int listener = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	check_error(listener, "socket");
+	int yes = 1;
+	check_error(setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)), "setsockopt");
+
+	struct sockaddr_in addr;
+	bzero((char *) &addr, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	check_error(bind(listener, (struct sockaddr *) &addr, sizeof(addr)), "bind");
+	check_error(listen(listener, SOMAXCONN), "listen");
+
+	int epfd = epoll_create1(0);
+	check_error(epfd, "epoll_create1");
+	// the listener is the one event without a session
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+	check_error(epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &event), "epoll_ctl");
+
+	srandom(time(NULL) ^ getpid());
+	printf("serving on 127.0.0.1:%d\n", port);
+	fflush(stdout);
+
+	struct epoll_event events[EVENTS_MAX];
+	for (;;) {
+		int n = epoll_wait(epfd, events, EVENTS_MAX, -1);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		check_error(n, "epoll_wait");
+
+		for (int i = 0; i < n; i++) {
+			Session *session = events[i].data.ptr;
+			if (!session) {
+				int fd;
+				while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+					session = malloc(sizeof(Session));
+					if (!session) {
+						close(fd);
+						continue;
+					}
+					line_init(&session->line, fd);
+					session->stage = AWAIT_USER;
+					session->writing = -1;
+					watch(epfd, session);
+				}
+				continue;
+			}
+
+			if (serve_event(group, session, events[i].events) != 0) {
+				close(session->line.fd);
+				free(session);
+			} else {
+				watch(epfd, session);
+			}
+		}
+	}
 }
 
-// calculate base ^ exp % mod
-// source: Wikipedia, Modular exponentiation
-// URL:    https://en.wikipedia.org/wiki/Modular_exponentiation
-int mod_exp(int base, int exp, int mod) {
-	if (mod == 1) {
-		return 0;
+// moves a server side session on. returns 0 while it is not over
+int serve_event(Group *group, Session *session, int events) {
+	int limbs = group->limbs, eof = 0;
+	char buff[BUFF_SIZE];
+
+	if (events & EPOLLERR) {
+		return -1;
 	}
+	if (events & (EPOLLIN | EPOLLHUP)) {
+		eof = line_fill(&session->line);
+		if (eof < 0) {
+			return -1;
+		}
+	}
+
+	while (session->stage != DONE && line_next(&session->line, buff, BUFF_SIZE, eof) >= 0) {
+		Limb x[MODEXP_LIMBS_MAX];
+		switch (session->stage) {
+		case AWAIT_USER:
+			snprintf(session->user, USER_MAX, "%.*s", USER_MAX - 1, buff);
+			session->stage = AWAIT_G_B;
+			break;
+		case AWAIT_G_B:
+			if (modexp_parse(x, limbs, buff) < 0) {
+				return -1;
+			}
+			random_exponent(group, session->secret);
+			modexp_pow(&group->mod, session->shared, x, session->secret, limbs);
+			modexp_fixed_pow(&group->fixed, x, session->secret, limbs);
+			modexp_format(buff, BUFF_SIZE, x, limbs);
+			line_send(&session->line, buff);
+			session->stage = AWAIT_G_AB;
+			break;
+		case AWAIT_G_AB:
+			if (modexp_parse(x, limbs, buff) < 0 ||
+			    memcmp(x, session->shared, sizeof(Limb) * limbs) != 0) {
+				return -1;
+			}
+			snprintf(buff, BUFF_SIZE, "hello %s, the secret is shared", session->user);
+			line_send(&session->line, buff);
+			session->stage = DONE;
+			break;
+		}
+	}
+
+	int flushed = line_flush(&session->line);
+	if (flushed < 0) {
+		return -1;
+	}
+	// over once the message is out, or the client has gone
+	return (session->stage == DONE && flushed) || eof ? 1 : 0;
+}
 
-	int ans = 1;
-	base %= mod;
+// drives sessions handshakes with the server at host and port, concurrent
+// at once, then reports how fast they went
+void load(Group *group, const char *host, const char *port, long sessions, int concurrent) {
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
 
-	while (exp > 0) {
-		if (exp & 1) {
-			ans = (ans * base) % mod;
+	struct addrinfo hints, *addr;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	int err = getaddrinfo(host, port, &hints, &addr);
+	if (err) {
+		fprintf(stderr, "ERROR, %s: %s\n", host, gai_strerror(err));
+		exit(EXIT_FAILURE);
+	}
+
+	if (concurrent > sessions) {
+		concurrent = sessions;
+	}
+	Session *slots = malloc(sizeof(Session) * concurrent);
+	double *latencies = malloc(sizeof(double) * sessions);
+	struct epoll_event *events = malloc(sizeof(struct epoll_event) * EVENTS_MAX);
+	if (!slots || !latencies || !events) {
+		fprintf(stderr, "ERROR, out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int epfd = epoll_create1(0);
+	check_error(epfd, "epoll_create1");
+	srandom(time(NULL) ^ getpid());
+
+	long started = 0, finished = 0, done = 0, failed = 0;
+	double begin = now();
+
+	// a slot starts session after session, until one gets going
+	for (int i = 0; i < concurrent; i++) {
+		while (started < sessions) {
+			started++;
+			if (load_start(group, &slots[i], epfd, addr->ai_addr, addr->ai_addrlen) == 0) {
+				break;
+			}
+			failed++;
+			finished++;
 		}
+	}
 
-		exp >>= 1;
-		base = (base * base) % mod;
+	while (finished < sessions) {
+		int n = epoll_wait(epfd, events, EVENTS_MAX, -1);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		check_error(n, "epoll_wait");
+
+		for (int i = 0; i < n; i++) {
+			Session *session = events[i].data.ptr;
+			int over = load_event(group, session, events[i].events);
+			if (over == 0) {
+				watch(epfd, session);
+				continue;
+			}
+
+			close(session->line.fd);
+			finished++;
+			if (over > 0) {
+				latencies[done++] = now() - session->start;
+			} else {
+				failed++;
+			}
+			while (started < sessions) {
+				started++;
+				if (load_start(group, session, epfd, addr->ai_addr, addr->ai_addrlen) == 0) {
+					break;
+				}
+				failed++;
+				finished++;
+			}
+		}
 	}
 
-	return ans;
+	report(latencies, done, failed, now() - begin);
+
+	close(epfd);
+	freeaddrinfo(addr);
+	free(events);
+	free(latencies);
+	free(slots);
+}
+
+// connects a client side session, queueing everything it can send before
+// hearing back. returns -1 if it cannot connect
+int load_start(Group *group, Session *session, int epfd, struct sockaddr *addr, socklen_t addr_len) {
+	int limbs = group->limbs;
+	char buff[BUFF_SIZE];
+
+	session->start = now();
+	int fd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	check_error(fd, "socket");
+	if (connect(fd, addr, addr_len) < 0 && errno != EINPROGRESS) {
+		close(fd);
+		return -1;
+	}
+
+	line_init(&session->line, fd);
+	line_send(&session->line, USERNAME);
+	random_exponent(group, session->secret);
+	modexp_fixed_pow(&group->fixed, session->shared, session->secret, limbs);
+	modexp_format(buff, BUFF_SIZE, session->shared, limbs);
+	line_send(&session->line, buff);
+	session->stage = AWAIT_G_A;
+
+	// writable once connected
+	session->writing = -1;
+	watch(epfd, session);
+	return 0;
+}
+
+// moves a client side session on. returns 0 while it is not over, 1 once
+// the message has come, or -1 if it failed
+int load_event(Group *group, Session *session, int events) {
+	int limbs = group->limbs, eof = 0;
+	char buff[BUFF_SIZE];
+
+	if (events & EPOLLERR) {
+		return -1;
+	}
+	if (events & (EPOLLIN | EPOLLHUP)) {
+		eof = line_fill(&session->line);
+		if (eof < 0) {
+			return -1;
+		}
+	}
+
+	while (line_next(&session->line, buff, BUFF_SIZE, eof) >= 0) {
+		if (session->stage == AWAIT_MESSAGE) {
+			return 1;
+		}
+
+		Limb g_a[MODEXP_LIMBS_MAX];
+		if (modexp_parse(g_a, limbs, buff) < 0) {
+			return -1;
+		}
+		modexp_pow(&group->mod, session->shared, g_a, session->secret, limbs);
+		modexp_format(buff, BUFF_SIZE, session->shared, limbs);
+		line_send(&session->line, buff);
+		session->stage = AWAIT_MESSAGE;
+	}
+
+	if (eof || line_flush(&session->line) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+void report(double *latencies, long done, long failed, double elapsed) {
+	printf("%ld handshakes, %ld failed, in %.3f s: %.1f handshakes/s\n", done, failed, elapsed,
+	       done / elapsed);
+	if (!done) {
+		return;
+	}
+
+	qsort(latencies, done, sizeof(double), compare_doubles);
+	printf("latency ms: min %.3f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f\n",
+	       latencies[0] * 1e3, latencies[(long) (0.5 * (done - 1))] * 1e3,
+	       latencies[(long) (0.9 * (done - 1))] * 1e3, latencies[(long) (0.99 * (done - 1))] * 1e3,
+	       latencies[(long) (0.999 * (done - 1))] * 1e3, latencies[done - 1] * 1e3);
+
+	// a bucket for each power of 2 microseconds, the last holding any longer
+	long buckets[64] = { 0 }, most = 0;
+	int first = 63, last = 0;
+	for (long i = 0; i < done; i++) {
+		long us = latencies[i] * 1e6;
+		int b = 0;
+		while (b < 63 && 1L << b <= us) {
+			b++;
+		}
+		if (++buckets[b] > most) {
+			most = buckets[b];
+		}
+		first = b < first ? b : first;
+		last = b > last ? b : last;
+	}
+	for (int b = first; b <= last; b++) {
+		char bar[41];
+		int len = buckets[b] * 40 / most;
+		memset(bar, '#', len);
+		bar[len] = '\0';
+		printf("%10ld us | %8ld %5.1f%% %s\n", b > 0 ? 1L << (b - 1) : 0, buckets[b],
+		       100.0 * buckets[b] / done, bar);
+	}
+}
+
+// waits on what a session needs next: reading always, and writing while it
+// has lines queued
+void watch(int epfd, Session *session) {
+	int writing = line_pending(&session->line);
+	if (writing == session->writing) {
+		return;
+	}
+
+	struct epoll_event event = { .events = EPOLLIN | (writing ? EPOLLOUT : 0), .data.ptr = session };
+	check_error(epoll_ctl(epfd, session->writing < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+	                      session->line.fd, &event),
+	            "epoll_ctl");
+	session->writing = writing;
+}
+
+// writes a line to a blocking socket, or exits
+void send_line(Line *line, const char *str) {
+	if (line_send(line, str) < 0) {
+		fprintf(stderr, "ERROR, line too long\n");
+		exit(EXIT_FAILURE);
+	}
+	check_error(line_flush(line), "write");
+}
+
+// reads a line from a blocking socket into buff, BUFF_SIZE long, however
+// many pieces it comes in. returns its length, or -1 if the socket closed
+// first
+int receive_line(Line *line, char *buff) {
+	int eof = 0, len;
+	while ((len = line_next(line, buff, BUFF_SIZE, eof)) < 0) {
+		if (eof) {
+			return -1;
+		}
+		eof = line_fill(line);
+		check_error(eof, "read");
+	}
+	return len;
+}
+
+// an exponent as long as the modulus. it only has to differ from session
+// to session, not be secret
+void random_exponent(Group *group, Limb *out) {
+	for (int i = 0; i < group->limbs; i++) {
+		out[i] = (Limb) random() << 42 ^ (Limb) random() << 21 ^ random();
+	}
+}
+
+// every session is a socket, so allow as many as the hard limit does
+void raise_fd_limit(void) {
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+// reads a number given for name, as modexp_parse does, or exits
+void parse_number(Limb *out, int limbs, const char *str, const char *name) {
+	if (limbs < 0 || modexp_parse(out, limbs, str) < 0) {
+		fprintf(stderr, "ERROR, bad number for %s: %s\n", name, str);
+		exit(EXIT_FAILURE);
+	}
 }
 
 void check_error(int err, char *str) {
@@ -0,0 +1,71 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dict.h"
+
+#define GROWTH_FACTOR 2
+
+void dict_init(Dict *dict, const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	assert(fd >= 0);
+
+	struct stat st;
+	fstat(fd, &st);
+	dict->size = st.st_size;
+
+	// mmap will not map an empty file
+	dict->data = NULL;
+	if (dict->size > 0) {
+		dict->data = mmap(NULL, dict->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		assert(dict->data != MAP_FAILED);
+		posix_madvise(dict->data, dict->size, POSIX_MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	size_t alloc = 1024;
+	dict->start = malloc(sizeof(size_t) * alloc);
+	dict->len = malloc(sizeof(int) * alloc);
+	assert(dict->start && dict->len);
+	dict->count = 0;
+
+	size_t pos = 0;
+	while (pos < dict->size) {
+		char *nl = memchr(dict->data + pos, '\n', dict->size - pos);
+		size_t end = nl ? (size_t) (nl - dict->data) : dict->size;
+
+		if ((size_t) dict->count >= alloc) {
+			// growing must not overflow the sizes given to realloc
+			assert(alloc <= SIZE_MAX / GROWTH_FACTOR / sizeof(size_t));
+			alloc *= GROWTH_FACTOR;
+			dict->start = realloc(dict->start, sizeof(size_t) * alloc);
+			dict->len = realloc(dict->len, sizeof(int) * alloc);
+			assert(dict->start && dict->len);
+		}
+		dict->start[dict->count] = pos;
+		dict->len[dict->count] = end - pos;
+		dict->count++;
+
+		pos = end + 1;
+	}
+}
+
+void dict_free(Dict *dict) {
+	if (dict->data) {
+		munmap(dict->data, dict->size);
+	}
+	free(dict->start);
+	free(dict->len);
+}
+
+const char *dict_word(const Dict *dict, long i, int *len) {
+	*len = dict->len[i];
+	return dict->data + dict->start[i];
+}
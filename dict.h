@@ -0,0 +1,25 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include <stddef.h>
+
+// a word list mapped into memory, with an index of where each line is
+typedef struct {
+	char *data;
+	size_t size;
+
+	// offset and length of each line, not counting the newline
+	size_t *start;
+	int *len;
+	long count;
+} Dict;
+
+// maps filename and indexes its lines in one pass. a newline ending the
+// last line does not start another, empty one
+void dict_init(Dict *dict, const char *filename);
+void dict_free(Dict *dict);
+
+// the i'th line, len long and not terminated. valid until dict_free
+const char *dict_word(const Dict *dict, long i, int *len);
+
+#endif
@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "digests.h"
+
+#define GROWTH_FACTOR 2
+
+#define DIGESTS_MAGIC "crackdg1"
+#define FILENAME_MAX_LEN 256
+// guesses hashed at a time before taking the lock to add them
+#define DIGESTS_CHUNK 256
+
+// what a saved table starts with. entries are in native byte order, so a
+// table only loads on the kind of machine that wrote it
+typedef struct {
+	char magic[8];
+	uint64_t fingerprint;
+	int64_t count;
+} DigestsHeader;
+
+static uint64_t digests_prefix(const BYTE digest[]);
+static int compare_entries(const void *a, const void *b);
+
+void digests_init(Digests *digests, uint64_t fingerprint) {
+	digests->fingerprint = fingerprint;
+	digests->alloc = 1024;
+	digests->entries = malloc(sizeof(DigestEntry) * digests->alloc);
+	assert(digests->entries);
+	digests->count = 0;
+
+	digests->map = NULL;
+	digests->map_size = 0;
+
+	pthread_mutex_init(&digests->lock, NULL);
+}
+
+void digests_free(Digests *digests) {
+	if (digests->map) {
+		munmap(digests->map, digests->map_size);
+	} else {
+		free(digests->entries);
+	}
+	pthread_mutex_destroy(&digests->lock);
+}
+
+// 64 bit FNV-1a
+uint64_t digests_fingerprint(uint64_t fingerprint, const void *data, size_t len) {
+	const unsigned char *bytes = data;
+	if (!fingerprint) {
+		fingerprint = 0xcbf29ce484222325ULL;
+	}
+	for (size_t i = 0; i < len; i++) {
+		fingerprint ^= bytes[i];
+		fingerprint *= 0x100000001b3ULL;
+	}
+	return fingerprint;
+}
+
+void digests_add(Digests *digests, const char words[], size_t stride, const size_t len[], size_t n) {
+	BYTE hashes[DIGESTS_CHUNK * SHA256_BLOCK_SIZE];
+
+	for (size_t i = 0; i < n; i += DIGESTS_CHUNK) {
+		size_t chunk = n - i < DIGESTS_CHUNK ? n - i : DIGESTS_CHUNK;
+		sha256_batch((const BYTE *) words + i * stride, stride, len + i, chunk, hashes);
+
+		pthread_mutex_lock(&digests->lock);
+		if (digests->count + (long) chunk > digests->alloc) {
+			digests->alloc *= GROWTH_FACTOR;
+			digests->entries = realloc(digests->entries, sizeof(DigestEntry) * digests->alloc);
+			assert(digests->entries);
+		}
+		for (size_t j = 0; j < chunk; j++) {
+			DigestEntry *entry = &digests->entries[digests->count++];
+			assert(len[i + j] <= DIGESTS_WORD_MAX);
+			entry->prefix = digests_prefix(&hashes[j * SHA256_BLOCK_SIZE]);
+			entry->len = len[i + j];
+			memset(entry->word, 0, DIGESTS_WORD_MAX);
+			memcpy(entry->word, words + (i + j) * stride, len[i + j]);
+		}
+		pthread_mutex_unlock(&digests->lock);
+	}
+}
+
+int digests_save(Digests *digests, const char *filename) {
+	qsort(digests->entries, digests->count, sizeof(DigestEntry), compare_entries);
+
+	DigestsHeader header;
+	memcpy(header.magic, DIGESTS_MAGIC, sizeof(header.magic));
+	header.fingerprint = digests->fingerprint;
+	header.count = digests->count;
+
+	// written aside first, so a run reading it never sees half a table
+	char tmp[FILENAME_MAX_LEN];
+	snprintf(tmp, FILENAME_MAX_LEN, "%s.%ld.tmp", filename, (long) getpid());
+	FILE *fp = fopen(tmp, "wb");
+	if (!fp) {
+		return -1;
+	}
+	int ok = fwrite(&header, sizeof(header), 1, fp) == 1
+	         && fwrite(digests->entries, sizeof(DigestEntry), digests->count, fp) == (size_t) digests->count;
+	ok &= fclose(fp) == 0;
+	if (!ok || rename(tmp, filename) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+int digests_load(Digests *digests, const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+
+	DigestsHeader header;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || read(fd, &header, sizeof(header)) != sizeof(header)
+	    || memcmp(header.magic, DIGESTS_MAGIC, sizeof(header.magic))
+	    || header.fingerprint != digests->fingerprint
+	    || (size_t) st.st_size != sizeof(header) + header.count * sizeof(DigestEntry)) {
+		close(fd);
+		return 0;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+
+	free(digests->entries);
+	digests->map = map;
+	digests->map_size = st.st_size;
+	digests->entries = (DigestEntry *) ((char *) map + sizeof(header));
+	digests->count = header.count;
+	digests->alloc = header.count;
+
+	return 1;
+}
+
+int digests_find(const Digests *digests, const BYTE digest[], char *word) {
+	uint64_t prefix = digests_prefix(digest);
+
+	// the first entry not below the prefix
+	long lo = 0, hi = digests->count;
+	while (lo < hi) {
+		long mid = lo + (hi - lo) / 2;
+		if (digests->entries[mid].prefix < prefix) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	// a shared prefix is almost certainly the guess, but make sure
+	for (long i = lo; i < digests->count && digests->entries[i].prefix == prefix; i++) {
+		const DigestEntry *entry = &digests->entries[i];
+		BYTE hash[SHA256_BLOCK_SIZE];
+		sha256_short((const BYTE *) entry->word, entry->len, hash);
+		if (!memcmp(hash, digest, SHA256_BLOCK_SIZE)) {
+			memcpy(word, entry->word, entry->len);
+			return entry->len;
+		}
+	}
+
+	return -1;
+}
+
+static uint64_t digests_prefix(const BYTE digest[]) {
+	uint64_t prefix = 0;
+	for (int i = 0; i < 8; i++) {
+		prefix = prefix << 8 | digest[i];
+	}
+	return prefix;
+}
+
+static int compare_entries(const void *a, const void *b) {
+	const DigestEntry *x = a, *y = b;
+	return (x->prefix > y->prefix) - (x->prefix < y->prefix);
+}
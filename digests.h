@@ -0,0 +1,58 @@
+#ifndef DIGESTS_H
+#define DIGESTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sha256.h"
+
+// a table of the digests of a set of guesses that is the same every run,
+// sorted by digest so targets can be looked up rather than the guesses hashed
+// again. it is saved with a fingerprint of whatever made the guesses, and
+// only loaded back while that still matches
+
+// longest guess the table holds, keeping an entry to 16 bytes
+#define DIGESTS_WORD_MAX 7
+
+typedef struct {
+	// the first 8 bytes of the digest, most significant first
+	uint64_t prefix;
+	unsigned char len;
+	char word[DIGESTS_WORD_MAX];
+} DigestEntry;
+
+typedef struct {
+	uint64_t fingerprint;
+	DigestEntry *entries;
+	long count, alloc;
+
+	// the file, if the entries were loaded from one
+	void *map;
+	size_t map_size;
+
+	pthread_mutex_t lock;
+} Digests;
+
+// starts an empty table of guesses made by whatever fingerprint stands for
+void digests_init(Digests *digests, uint64_t fingerprint);
+void digests_free(Digests *digests);
+
+// folds len bytes of data into a fingerprint, starting from 0
+uint64_t digests_fingerprint(uint64_t fingerprint, const void *data, size_t len);
+
+// hashes n guesses, guess i at words + i * stride and len[i] long, and adds
+// them to the table. safe to call from any thread
+void digests_add(Digests *digests, const char words[], size_t stride, const size_t len[], size_t n);
+// sorts the table and atomically replaces filename with it, returning -1 if
+// it could not be written
+int digests_save(Digests *digests, const char *filename);
+// maps the table in filename in place of an empty one, returning 0 if there
+// is none or it was made from something other than the fingerprint
+int digests_load(Digests *digests, const char *filename);
+
+// finds a guess hashing to digest in a sorted table, copying it to word and
+// returning its length, or -1 if there is none
+int digests_find(const Digests *digests, const BYTE digest[], char *word);
+
+#endif
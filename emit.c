@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "emit.h"
+
+static void emit_wait(Emit *emit, EmitBuffer *out);
+static void emit_write(Emit *emit, EmitBuffer *out);
+
+void emit_init(Emit *emit, int fd, int workers, long limit) {
+	emit->fd = fd;
+	emit->remaining = limit;
+	emit->done = limit == 0;
+
+	emit->units = emit->claimed = emit->next = 0;
+	emit->workers = workers;
+	emit->buffers = malloc(sizeof(EmitBuffer) * workers);
+	assert(emit->buffers);
+	for (int i = 0; i < workers; i++) {
+		emit->buffers[i].buf = malloc(EMIT_BUFFER_SIZE);
+		assert(emit->buffers[i].buf);
+		emit->buffers[i].len = 0;
+		emit->buffers[i].lines = 0;
+		emit->buffers[i].unit = -1;
+	}
+
+	pthread_mutex_init(&emit->lock, NULL);
+	pthread_cond_init(&emit->turn, NULL);
+}
+
+void emit_free(Emit *emit) {
+	for (int i = 0; i < emit->workers; i++) {
+		free(emit->buffers[i].buf);
+	}
+	free(emit->buffers);
+
+	pthread_mutex_destroy(&emit->lock);
+	pthread_cond_destroy(&emit->turn);
+}
+
+void emit_phase(Emit *emit, long units) {
+	pthread_mutex_lock(&emit->lock);
+	emit->units = units;
+	emit->claimed = emit->next = 0;
+	pthread_mutex_unlock(&emit->lock);
+}
+
+long emit_claim(Emit *emit, int worker) {
+	long unit = -1;
+
+	pthread_mutex_lock(&emit->lock);
+	if (!emit->done && emit->claimed < emit->units) {
+		unit = emit->claimed++;
+	}
+	emit->buffers[worker].unit = unit;
+	pthread_mutex_unlock(&emit->lock);
+
+	return unit;
+}
+
+int emit_word(Emit *emit, int worker, const char *word, int len) {
+	EmitBuffer *out = &emit->buffers[worker];
+
+	// a full buffer has to wait its turn to be written before taking more
+	if (out->len + len + 1 > EMIT_BUFFER_SIZE) {
+		emit_wait(emit, out);
+		emit_write(emit, out);
+	}
+
+	memcpy(out->buf + out->len, word, len);
+	out->buf[out->len + len] = '\n';
+	out->len += len + 1;
+	out->lines++;
+
+	return emit_more(emit);
+}
+
+void emit_end(Emit *emit, int worker) {
+	EmitBuffer *out = &emit->buffers[worker];
+
+	emit_wait(emit, out);
+	emit_write(emit, out);
+
+	pthread_mutex_lock(&emit->lock);
+	emit->next++;
+	out->unit = -1;
+	pthread_cond_broadcast(&emit->turn);
+	pthread_mutex_unlock(&emit->lock);
+}
+
+int emit_more(Emit *emit) {
+	return !__atomic_load_n(&emit->done, __ATOMIC_RELAXED);
+}
+
+// waits until every unit before out's has been written, or nothing more will be
+static void emit_wait(Emit *emit, EmitBuffer *out) {
+	pthread_mutex_lock(&emit->lock);
+	while (!emit->done && emit->next != out->unit) {
+		pthread_cond_wait(&emit->turn, &emit->lock);
+	}
+	pthread_mutex_unlock(&emit->lock);
+}
+
+// writes out what is buffered, up to the limit. only the worker whose turn it
+// is gets here, so it has the file to itself
+static void emit_write(Emit *emit, EmitBuffer *out) {
+	size_t len = out->len;
+	int last = 0;
+
+	// once done, whatever is left is not wanted
+	if (!emit_more(emit)) {
+		len = 0;
+	} else if (emit->remaining >= 0 && out->lines >= emit->remaining) {
+		// cut after the last line wanted
+		len = 0;
+		for (long i = 0; i < emit->remaining; i++) {
+			len = (char *) memchr(out->buf + len, '\n', out->len - len) - out->buf + 1;
+		}
+		last = 1;
+	} else if (emit->remaining >= 0) {
+		emit->remaining -= out->lines;
+	}
+
+	for (size_t off = 0; off < len;) {
+		ssize_t n = write(emit->fd, out->buf + off, len - off);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EPIPE) {
+				perror("write");
+			}
+			last = 1;
+			break;
+		}
+		off += n;
+	}
+
+	out->len = 0;
+	out->lines = 0;
+
+	if (last) {
+		pthread_mutex_lock(&emit->lock);
+		emit->remaining = 0;
+		__atomic_store_n(&emit->done, 1, __ATOMIC_RELAXED);
+		pthread_cond_broadcast(&emit->turn);
+		pthread_mutex_unlock(&emit->lock);
+	}
+}
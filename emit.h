@@ -0,0 +1,50 @@
+#ifndef EMIT_H
+#define EMIT_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// how much of its unit a worker can get ahead of the one being written
+#define EMIT_BUFFER_SIZE (1 << 20)
+
+// a worker's unit of guesses, formatted one per line and yet to be written
+typedef struct {
+	char *buf;
+	size_t len;
+	long lines;
+	long unit;      // -1 when not in a unit
+} EmitBuffer;
+
+typedef struct {
+	int fd;
+	// lines still wanted, or -1 for no limit
+	long remaining;
+	// set once nothing more will be written
+	int done;
+
+	// units of the current phase are claimed, and written, in order
+	long units, claimed, next;
+	EmitBuffer *buffers;
+	int workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t turn;
+} Emit;
+
+// sets up writing the guesses of workers to fd, in the order one worker would
+// make them. limit caps the lines written, -1 for no limit
+void emit_init(Emit *emit, int fd, int workers, long limit);
+void emit_free(Emit *emit);
+
+// starts a phase of units, to be claimed with emit_claim
+void emit_phase(Emit *emit, long units);
+// claims the next unit of the phase for worker, returning -1 if there are none
+long emit_claim(Emit *emit, int worker);
+// adds a guess to worker's unit, returning 0 once no more are wanted
+int emit_word(Emit *emit, int worker, const char *word, int len);
+// waits for every earlier unit to be written, then writes worker's
+void emit_end(Emit *emit, int worker);
+// whether more guesses are wanted
+int emit_more(Emit *emit);
+
+#endif
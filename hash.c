@@ -0,0 +1,378 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "hash.h"
+
+#define GROWTH_FACTOR 2
+// longest line of a potfile
+#define POT_LINE_MAX 1024
+
+static void hash_done(Hash *hash, HashTable *table, Target *target);
+static int pot_target(Hash *hash, char *line, int *len);
+static int pot_word(Hash *hash, const char *word, int len);
+
+void hash_init(Hash *hash, char **filenames, int *lens, int n_files) {
+	hash->files = malloc(sizeof(HashFile) * n_files);
+	assert(hash->files);
+	hash->n_files = n_files;
+
+	// find out how long the files are
+	long len = 0;
+	for (int i = 0; i < n_files; i++) {
+		struct stat st;
+		int err = stat(filenames[i], &st);
+		assert(!err);
+		len += st.st_size;
+	}
+
+	hash->hashes = malloc(sizeof(BYTE) * (len > 0 ? len : 1));
+	assert(hash->hashes);
+	hash->count = 0;
+
+	for (int i = 0; i < n_files; i++) {
+		FILE *fp = fopen(filenames[i], "rb");
+		assert(fp);
+		BYTE *at = &hash->hashes[hash->count * SHA256_BLOCK_SIZE];
+		long read = fread(at, sizeof(char), len - hash->count * SHA256_BLOCK_SIZE, fp);
+		fclose(fp);
+
+		HashFile *file = &hash->files[i];
+		file->filename = filenames[i];
+		file->len = lens[i];
+		file->first = hash->count;
+		file->count = read / SHA256_BLOCK_SIZE;
+		hash->count += file->count;
+	}
+
+	// index the targets by key in tables at most half full, so probes for
+	// candidates that miss stay short. duplicate digests get a slot each
+	for (int l = 0; l <= HASH_LEN_MAX; l++) {
+		HashTable *table = &hash->tables[l];
+		table->count = 0;
+		for (int i = 0; i < n_files; i++) {
+			table->count += hash->files[i].len == l ? hash->files[i].count : 0;
+		}
+		table->live = table->count;
+
+		int size = 4;
+		while (size < 2 * table->count) {
+			size *= GROWTH_FACTOR;
+		}
+		table->mask = size - 1;
+
+		table->slots = malloc(sizeof(Target) * size);
+		assert(table->slots);
+		for (int i = 0; i < size; i++) {
+			table->slots[i].index = -1;
+		}
+	}
+
+	for (int f = 0; f < n_files; f++) {
+		HashFile *file = &hash->files[f];
+		HashTable *table = &hash->tables[file->len];
+		for (int i = file->first; i < file->first + file->count; i++) {
+			WORD key = hash_key(&hash->hashes[i * SHA256_BLOCK_SIZE]);
+			WORD slot = key & table->mask;
+			while (table->slots[slot].index >= 0) {
+				slot = (slot + 1) & table->mask;
+			}
+			table->slots[slot].key = key;
+			table->slots[slot].index = i;
+			table->slots[slot].done = 0;
+		}
+	}
+
+	hash->live = hash->count;
+	hash->pipe = NULL;
+	pthread_mutex_init(&hash->lock, NULL);
+	hash->checkpoint = NULL;
+	hash->stats = NULL;
+	hash->pot = NULL;
+}
+
+void hash_free(Hash *hash) {
+	free(hash->hashes);
+	free(hash->files);
+	for (int l = 0; l <= HASH_LEN_MAX; l++) {
+		free(hash->tables[l].slots);
+	}
+	if (hash->pot) {
+		fclose(hash->pot);
+	}
+	pthread_mutex_destroy(&hash->lock);
+}
+
+WORD hash_key(const BYTE *digest) {
+	// with early rejection a candidate only has its state a few rounds from
+	// the end to look up with
+	if (EARLY_REJECT) {
+		return sha256_early_target(digest);
+	}
+	return (digest[0] << 24) | (digest[1] << 16) | (digest[2] << 8) | digest[3];
+}
+
+void hash_mark(Hash *hash, int index) {
+	HashTable *table = &hash->tables[hash_file(hash, index)->len];
+
+	WORD key = hash_key(&hash->hashes[index * SHA256_BLOCK_SIZE]);
+	pthread_mutex_lock(&hash->lock);
+	for (WORD slot = key & table->mask; table->slots[slot].index >= 0;
+	     slot = (slot + 1) & table->mask) {
+		Target *target = &table->slots[slot];
+		if (target->index == index && !target->done) {
+			hash_done(hash, table, target);
+		}
+	}
+	pthread_mutex_unlock(&hash->lock);
+}
+
+int hash_potfile(Hash *hash, const char *filename) {
+	int marked = 0;
+
+	// there is nothing to skip the first time
+	FILE *fp = fopen(filename, "r");
+	if (fp) {
+		char line[POT_LINE_MAX];
+		while (fgets(line, POT_LINE_MAX, fp)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			char word[POT_LINE_MAX];
+			strcpy(word, line);
+			int len, index = pot_target(hash, line, &len);
+
+			// a potfile from some other set of targets must not hide these
+			if (index >= 0) {
+				SHA256_CTX ctx;
+				BYTE digest[SHA256_BLOCK_SIZE];
+				sha256_init(&ctx);
+				sha256_update(&ctx, (BYTE *) line, len);
+				sha256_final(&ctx, digest);
+				if (!memcmp(digest, &hash->hashes[index * SHA256_BLOCK_SIZE], SHA256_BLOCK_SIZE)) {
+					hash_mark(hash, index);
+					marked++;
+					continue;
+				}
+			}
+
+			// found.txt lines are just the word, which cracks whatever it
+			// hashes to
+			marked += pot_word(hash, word, strlen(word));
+		}
+		fclose(fp);
+	}
+
+	// kept open for the whole run, a line written out per hit
+	hash->pot = fopen(filename, "a");
+	if (!hash->pot) {
+		return -1;
+	}
+	setvbuf(hash->pot, NULL, _IOLBF, 0);
+
+	return marked;
+}
+
+// finds the target a potfile line "<word> <index>[ <file>]" is for, cutting
+// the line down to the word. passwords can contain spaces, so the index is
+// after the last one, unless that is the file. returns -1 if it is for none
+static int pot_target(Hash *hash, char *line, int *len) {
+	char *space = strrchr(line, ' '), *file = NULL, *end;
+	if (!space) {
+		return -1;
+	}
+	long index = strtol(space + 1, &end, 10);
+	if (*end != '\0' || end == space + 1) {
+		file = space + 1;
+		*space = '\0';
+		space = strrchr(line, ' ');
+		if (!space) {
+			return -1;
+		}
+		index = strtol(space + 1, &end, 10);
+		if (*end != '\0' || end == space + 1) {
+			return -1;
+		}
+	}
+	*space = '\0';
+	*len = space - line;
+
+	// numbered from 1 within the file, and without one only the first fits
+	for (int i = 0; i < hash->n_files; i++) {
+		HashFile *f = &hash->files[i];
+		if ((file ? !strcmp(file, f->filename) : i == 0) && 1 <= index && index <= f->count) {
+			return f->first + index - 1;
+		}
+	}
+	return -1;
+}
+
+// marks every target, of any length, with the digest of word. returns how
+// many there were
+static int pot_word(Hash *hash, const char *word, int len) {
+	BYTE digest[SHA256_BLOCK_SIZE];
+	if (len <= SHA256_SHORT_MAX) {
+		sha256_short((BYTE *) word, len, digest);
+	} else {
+		SHA256_CTX ctx;
+		sha256_init(&ctx);
+		sha256_update(&ctx, (BYTE *) word, len);
+		sha256_final(&ctx, digest);
+	}
+
+	int marked = 0;
+	WORD key = hash_key(digest);
+	pthread_mutex_lock(&hash->lock);
+	for (int l = 0; l <= HASH_LEN_MAX; l++) {
+		HashTable *table = &hash->tables[l];
+		for (WORD slot = key & table->mask; table->slots[slot].index >= 0;
+		     slot = (slot + 1) & table->mask) {
+			Target *target = &table->slots[slot];
+			if (target->key == key && !target->done
+			    && !memcmp(digest, &hash->hashes[target->index * SHA256_BLOCK_SIZE], SHA256_BLOCK_SIZE)) {
+				hash_done(hash, table, target);
+				marked++;
+			}
+		}
+	}
+	pthread_mutex_unlock(&hash->lock);
+
+	return marked;
+}
+
+HashFile *hash_file(Hash *hash, int index) {
+	HashFile *file = hash->files;
+	while (index >= file->first + file->count) {
+		file++;
+	}
+	return file;
+}
+
+int hash_wants(Hash *hash, int len) {
+	return __atomic_load_n(&hash->tables[0].live, __ATOMIC_RELAXED) > 0
+	       || (len <= HASH_LEN_MAX && __atomic_load_n(&hash->tables[len].live, __ATOMIC_RELAXED) > 0);
+}
+
+void check_word(Hash *hash, const char *word, int len) {
+	if (EARLY_REJECT) {
+		check_key(hash, sha256_short_early((BYTE *) word, len), word, len, NULL);
+	} else {
+		BYTE word_hash[SHA256_BLOCK_SIZE];
+		sha256_short((BYTE *) word, len, word_hash);
+		check_key(hash, hash_key(word_hash), word, len, word_hash);
+	}
+}
+
+void check_key(Hash *hash, WORD key, const char *word, int len, const BYTE *digest) {
+	BYTE word_hash[SHA256_BLOCK_SIZE];
+
+	// only targets for any length, and for this one, could match
+	digest = check_table(hash, &hash->tables[0], key, word, len, digest, word_hash);
+	if (len <= HASH_LEN_MAX) {
+		check_table(hash, &hash->tables[len], key, word, len, digest, word_hash);
+	}
+}
+
+const BYTE *check_table(Hash *hash, HashTable *table, WORD key, const char *word, int len,
+                        const BYTE *digest, BYTE *word_hash) {
+	// every target sharing the key sits in the run of slots from key's home,
+	// only those are worth the full digest and compare
+	for (WORD slot = key & table->mask; table->slots[slot].index >= 0;
+	     slot = (slot + 1) & table->mask) {
+		Target *target = &table->slots[slot];
+		if (__atomic_load_n(&target->done, __ATOMIC_RELAXED) || target->key != key) {
+			continue;
+		}
+
+		if (!digest) {
+			sha256_short((BYTE *) word, len, word_hash);
+			digest = word_hash;
+		}
+
+		if (!memcmp(digest, &hash->hashes[target->index * SHA256_BLOCK_SIZE], SHA256_BLOCK_SIZE)) {
+			// another worker may have got here first
+			pthread_mutex_lock(&hash->lock);
+			if (!target->done) {
+				hash_done(hash, table, target);
+				print_found(hash, word, len, target->index);
+				if (hash->checkpoint) {
+					checkpoint_found(hash->checkpoint, target->index);
+				}
+				if (hash->stats) {
+					stats_hit(hash->stats);
+				}
+			}
+			pthread_mutex_unlock(&hash->lock);
+		}
+	}
+
+	return digest;
+}
+
+void print_found(Hash *hash, const char *word, int len, int index) {
+	HashFile *file = hash_file(hash, index);
+
+	if (hash->n_files > 1) {
+		printf("%.*s %d %s\n", len, word, index - file->first + 1, file->filename);
+		if (hash->pot) {
+			fprintf(hash->pot, "%.*s %d %s\n", len, word, index - file->first + 1, file->filename);
+		}
+	} else {
+		printf("%.*s %d\n", len, word, index + 1);
+		if (hash->pot) {
+			fprintf(hash->pot, "%.*s %d\n", len, word, index + 1);
+		}
+	}
+	fflush(stdout);
+}
+
+// marks a target found, stopping the pipeline once there are none left.
+// call with the lock held
+static void hash_done(Hash *hash, HashTable *table, Target *target) {
+	__atomic_store_n(&target->done, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&table->live, table->live - 1, __ATOMIC_RELAXED);
+	if (--hash->live == 0 && hash->pipe) {
+		pipeline_stop(hash->pipe);
+	}
+}
+
+void check_batch(void *arg, Batch *batch) {
+	Hash *hash = arg;
+	WORD keys[BATCH_SIZE];
+
+	// guesses no target could be are not worth hashing
+	int wanted = 1;
+	for (int i = 0; i < batch->count; i++) {
+		wanted &= hash_wants(hash, batch->len[i]);
+	}
+	Batch kept;
+	if (!wanted) {
+		kept.count = 0;
+		for (int i = 0; i < batch->count; i++) {
+			if (hash_wants(hash, batch->len[i])) {
+				memcpy(&kept.words[kept.count * BATCH_WORD_MAX], &batch->words[i * BATCH_WORD_MAX], batch->len[i]);
+				kept.len[kept.count++] = batch->len[i];
+			}
+		}
+		batch = &kept;
+	}
+	if (hash->stats) {
+		stats_hashed(hash->stats, batch->count);
+	}
+
+	// hash the whole batch across the vector lanes at once
+	if (EARLY_REJECT) {
+		sha256_batch_early((BYTE *) batch->words, BATCH_WORD_MAX, batch->len, batch->count, keys);
+		for (int i = 0; i < batch->count; i++) {
+			check_key(hash, keys[i], &batch->words[i * BATCH_WORD_MAX], batch->len[i], NULL);
+		}
+	} else {
+		BYTE digests[BATCH_SIZE * SHA256_BLOCK_SIZE];
+		sha256_batch((BYTE *) batch->words, BATCH_WORD_MAX, batch->len, batch->count, digests);
+		for (int i = 0; i < batch->count; i++) {
+			BYTE *digest = &digests[i * SHA256_BLOCK_SIZE];
+			check_key(hash, hash_key(digest), &batch->words[i * BATCH_WORD_MAX], batch->len[i], digest);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "sha256.h"
+#include "pipeline.h"
+#include "checkpoint.h"
+#include "stats.h"
+
+// the targets being cracked, from one or more files of SHA256 digests, and
+// checking guesses against them
+
+// longest word a file of targets can be set aside for
+#define HASH_LEN_MAX 16
+
+// compare a single state word a few rounds before the end of the hash, only
+// finishing candidates that match a target. build with -DEARLY_REJECT=0 to
+// always compute full digests
+#ifndef EARLY_REJECT
+#define EARLY_REJECT 1
+#endif
+
+// a slot in the open addressing index over the target digests
+typedef struct {
+	WORD key;
+	int index;
+	int done;
+} Target;
+
+typedef struct {
+	Target *slots;
+	WORD mask;
+	// how many targets it has, and how many of those are yet to be found
+	int count, live;
+} HashTable;
+
+// a file of target digests, and the length of word they are for, 0 if any
+typedef struct {
+	char *filename;
+	int len;
+	// where its targets start among all of them, and how many it has
+	int first, count;
+} HashFile;
+
+typedef struct {
+	// every target's digest, file after file
+	BYTE *hashes;
+	int count;
+	HashFile *files;
+	int n_files;
+	// targets for words of any length, then by the length they are for
+	HashTable tables[HASH_LEN_MAX + 1];
+	// targets yet to be found, and the pipeline stopped once there are none
+	int live;
+	Pipeline *pipe;
+	pthread_mutex_t lock;
+	Checkpoint *checkpoint;
+	// where cracked targets are appended, if anywhere
+	FILE *pot;
+	// counts hashes and hits, if not NULL
+	Stats *stats;
+} Hash;
+
+// loads targets from n_files filenames, each for words of lens[i] long, or
+// any length if 0
+void hash_init(Hash *hash, char **filenames, int *lens, int n_files);
+void hash_free(Hash *hash);
+// the 32 bits of a digest the target index is keyed on
+WORD hash_key(const BYTE *digest);
+// marks the target at index as already found
+void hash_mark(Hash *hash, int index);
+// marks every target cracked in the potfile filename, in the format
+// print_found writes or a bare word a line as in found.txt, as already
+// found, then appends new ones to it. returns how many were marked, or -1 if
+// it cannot be appended to
+int hash_potfile(Hash *hash, const char *filename);
+// whether any target yet to be found could be a word len long
+int hash_wants(Hash *hash, int len);
+// the file the target at index came from
+HashFile *hash_file(Hash *hash, int index);
+
+// checks a word against the targets, printing it if it cracks one
+void check_word(Hash *hash, const char *word, int len);
+// checks a word by the key of its hash, and its digest if already known
+void check_key(Hash *hash, WORD key, const char *word, int len, const BYTE *digest);
+// checks against the targets in one table, returning the digest if it had
+// to be computed
+const BYTE *check_table(Hash *hash, HashTable *table, WORD key, const char *word, int len,
+                        const BYTE *digest, BYTE *word_hash);
+// prints a cracked target, numbered from 1 within its file, and adds it to
+// the potfile. with more than one file, the file it is from follows
+void print_found(Hash *hash, const char *word, int len, int index);
+// sink for the pipeline, hashing a batch of guesses
+void check_batch(void *arg, Batch *batch);
+
+#endif
@@ -0,0 +1,91 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "line.h"
+
+void line_init(Line *line, int fd) {
+	line->fd = fd;
+	line->in_len = 0;
+	line->out_len = line->out_sent = 0;
+}
+
+int line_fill(Line *line) {
+	if (line->in_len == LINE_SIZE) {
+		return -1;
+	}
+
+	ssize_t got = read(line->fd, line->in + line->in_len, LINE_SIZE - line->in_len);
+	if (got < 0) {
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+	}
+	if (got == 0) {
+		return 1;
+	}
+
+	line->in_len += got;
+	return 0;
+}
+
+int line_next(Line *line, char *buf, int size, int eof) {
+	char *end = memchr(line->in, '\n', line->in_len);
+	int len, used;
+	if (end) {
+		len = end - line->in;
+		used = len + 1;
+	} else if (eof && line->in_len > 0) {
+		len = used = line->in_len;
+	} else {
+		return -1;
+	}
+
+	// a line too long for buf is cut short
+	if (len > size - 1) {
+		len = size - 1;
+	}
+	memcpy(buf, line->in, len);
+	buf[len] = '\0';
+	if (len > 0 && buf[len - 1] == '\r') {
+		buf[--len] = '\0';
+	}
+
+	line->in_len -= used;
+	memmove(line->in, line->in + used, line->in_len);
+	return len;
+}
+
+int line_send(Line *line, const char *str) {
+	// make room by dropping what has already been written
+	if (line->out_sent > 0) {
+		line->out_len -= line->out_sent;
+		memmove(line->out, line->out + line->out_sent, line->out_len);
+		line->out_sent = 0;
+	}
+
+	int len = strlen(str);
+	if (line->out_len + len + 1 > LINE_SIZE) {
+		return -1;
+	}
+	memcpy(line->out + line->out_len, str, len);
+	line->out_len += len;
+	line->out[line->out_len++] = '\n';
+	return 0;
+}
+
+int line_flush(Line *line) {
+	while (line->out_sent < line->out_len) {
+		ssize_t put = write(line->fd, line->out + line->out_sent, line->out_len - line->out_sent);
+		if (put < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+		line->out_sent += put;
+	}
+	return 1;
+}
+
+int line_pending(const Line *line) {
+	return line->out_sent < line->out_len;
+}
@@ -0,0 +1,40 @@
+#ifndef LINE_H
+#define LINE_H
+
+// a socket spoken to a line at a time, as dh's protocol is. reads and writes
+// can come in any size of piece, so what is read is kept until a whole line
+// has arrived, and what is to be written until the socket takes it. works
+// the same on blocking and non blocking sockets
+
+// longest line either way, newline included. a 2048 bit number is 617 digits
+#define LINE_SIZE 1024
+
+typedef struct {
+	int fd;
+	// read but not yet taken as a line
+	char in[LINE_SIZE];
+	int in_len;
+	// yet to be written, from out_sent on
+	char out[LINE_SIZE];
+	int out_len, out_sent;
+} Line;
+
+void line_init(Line *line, int fd);
+
+// reads once from the socket. returns 0 if it may have more later, 1 at end
+// of file, or -1 on an error or a line too long to keep
+int line_fill(Line *line);
+// takes the next whole line read, without its newline, into buf, size long.
+// at end of file, what is left counts as a line. returns its length, or -1 if
+// there is none yet
+int line_next(Line *line, char *buf, int size, int eof);
+
+// queues str to be written as a line. returns -1 if there is no room for it
+int line_send(Line *line, const char *str);
+// writes as much of the queue as the socket will take. returns 1 once it is
+// all written, 0 if some is left, or -1 on an error
+int line_flush(Line *line);
+// whether some of the queue is yet to be written
+int line_pending(const Line *line);
+
+#endif
@@ -1,382 +1,1245 @@
-#include <stdlib.h>
-#include <stdio.h>
-#include <stddef.h>
-#include <string.h>
-#include <assert.h>
-#include <sys/stat.h>
-
-#include "sha256.h"
-
-#define GROWTH_FACTOR 2
-
-#define PWD4SHA256  "pwd4sha256"
-#define PWD6SHA256  "pwd6sha256"
-#define PWDXSHA256  "pwdXsha256"
-
-#define DICT_FILE "dict.txt"
-
-#define BRUTE_MODE 1
-#define GUESS_MODE 2
-#define TEST_MODE  3
-
-#define LEN_PWD_MIN    4
-#define LEN_PWD_MAX    6
-#define CHAR_PWD_MIN  32
-#define CHAR_PWD_MAX 126
-#define MAX_SUBS       3
-
-// remnants of an old brute force solution
-#define NEXT_CHAR(C) (((((C) - CHAR_PWD_MIN + 1) % \
-(CHAR_PWD_MAX - CHAR_PWD_MIN + 1)) + CHAR_PWD_MIN))
-#define CARRIED_CHAR(C) ((C) == CHAR_PWD_MIN)
-
-typedef struct {
-	BYTE *hashes;
-	int *done;
-	int count;
-} Hash;
-
-typedef struct {
-	char *word;
-	int *index;
-	int alloc;
-} Word;
-
-void test_passwords(char *pwd_filename, char *sha_filename);
-
-int read_line(FILE *fp, Word *word);
-void print_sha256(BYTE *hash);
-
-void word_init(Word *word);
-void word_free(Word *word);
-void word_reset(Word *word, int min, const char *set);
-
-void hash_init(Hash *hash, char *filename);
-void hash_free(Hash *hash);
-
-// generates up to count guesses if sha_filename is NULL, 
-// else generates and checkes guesses against the hashes
-void generate_guesses(long count, char *sha_filename);
-
-// checks a word against a hash
-void check_hash(Word *word, Hash *hash, int len);
-// mutates word to be the next word in the set from offset
-int next_set(Word *word, int offset, int max, const char *set, int set_len);
-// guesses words in the DICT_FILE using a set
-void guess_set_dict(Word *word, const char *set, long *remaining, Hash *hash);
-// makes a guess. either prints or checks against hash
-void make_guess(Word *word, int len, long *remaining, Hash *hash);
-// guesses substitutions of words in the dictionary
-void guess_subs(Word *word, long *remaining, Hash *hash);
-// guesses and produces the next substituition for a word
-void next_sub(Word *word, int len, int index, int n_subs, long *remaining, Hash *hash);
-
-// various subsets of characters
-static const char *letters = "abcdefghijklmnopqrstuvwxyz";
-static const char *numbers = "0123456789";
-// static const char *special = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
-static const char *full = " !\"#$%&'()*+,-./0123456789:;<=>?" \
-                          "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_" \
-                          "`abcdefghijklmnopqrstuvwxyz{|}~";
-
-// substititutions for each character
-static const char *subs[] = {
-	"A@&", "B68", "C[(<", "D])>?", "E3", "F#", "G9", "H#", "I1|!",
-	"J", "K<", "L7", "M", "N^", "O0*", "P?", "Q9", "R",
-	"S5$2", "T+", "U", "V", "W", "X%", "Y", "Z2"
-};
-
-int main(int argc, char *argv[]) {
-
-	switch (argc) {
-	case BRUTE_MODE:
-		// this one could take a very long time. which it did :(
-		generate_guesses(-1, PWDXSHA256);
-		break;
-	case GUESS_MODE:
-		generate_guesses(strtol(argv[1], NULL, 10), NULL);
-		break;
-	case TEST_MODE:
-		test_passwords(argv[1], argv[2]);
-		break;
-	default:
-		printf("USAGE: <program> [<n_words : int> " \
-		       "| <words_file : string> <hashes_file : string>]\n");
-		exit(EXIT_FAILURE);
-	}
-
-	exit(EXIT_SUCCESS);
-
-	return 0;
-}
-
-void test_passwords(char *pwd_filename, char *sha_filename) {
-	Hash hash;
-	hash_init(&hash, sha_filename);
-
-	FILE *fp = fopen(pwd_filename, "r");
-
-	Word word;
-	word_init(&word);
-
-	while (!feof(fp)) {
-		int len = read_line(fp, &word);
-		check_hash(&word, &hash, len);
-	}
-
-	fclose(fp);
-
-	word_free(&word);
-	hash_free(&hash);
-}
-
-int read_line(FILE *fp, Word *word) {
-	int c = '\0', i = 0;
-
-	while ((c = fgetc(fp)) != EOF) {
-		if (c == '\n') {
-			break;
-		}
-
-		if (i >= word->alloc) {
-			word->alloc *= GROWTH_FACTOR;
-			word->word = realloc(word->word, sizeof(char) * word->alloc);
-			word->index = realloc(word->index, sizeof(int) * word->alloc);
-			assert(word->word && word->index);
-		}
-
-		word->word[i++] = c;
-	}
-
-	return i;
-}
-
-void print_sha256(BYTE *hash) {
-	for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
-		printf("%02x", hash[i]);
-	}
-}
-
-void word_init(Word *word) {
-	word->word = malloc(sizeof(char) * LEN_PWD_MAX);
-	word->index = malloc(sizeof(int) * LEN_PWD_MAX);
-	assert(word->word && word->index);
-
-	word->alloc = LEN_PWD_MAX;
-
-	word_reset(word, 0, letters);
-}
-
-void word_free(Word *word) {
-	free(word->word);
-	free(word->index);
-}
-
-void word_reset(Word *word, int min, const char *set) {
-	for (int i = min; i < LEN_PWD_MAX; i++) {
-		word->index[i] = 0;
-		word->word[i] = set[0];
-	}
-}
-
-void hash_init(Hash *hash, char *filename) {
-	FILE *fp = fopen(filename, "rb");
-	assert(fp);
-
-	// find out how long the file is
-	struct stat st;
-	stat(filename, &st);
-	long len = st.st_size;
-
-	hash->hashes = malloc(sizeof(BYTE) * len);
-	assert(hash->hashes);
-	len = fread(hash->hashes, sizeof(char), len, fp);
-	fclose(fp);
-
-	hash->count = len / SHA256_BLOCK_SIZE;
-
-	hash->done = malloc(sizeof(int) * hash->count);
-	assert(hash->done);
-
-	memset(hash->done, 0, sizeof(int) * hash->count);
-}
-
-void hash_free(Hash *hash) {
-	free(hash->hashes);
-	free(hash->done);
-}
-
-void check_hash(Word *word, Hash *hash, int len) {
-	BYTE word_hash[SHA256_BLOCK_SIZE];
-
-	SHA256_CTX sha_ctx;
-	sha256_init(&sha_ctx);
-	sha256_update(&sha_ctx, (BYTE *) word->word, len);
-	sha256_final(&sha_ctx, word_hash);
-
-	// check the hash of word against those in hash
-	for (int i = 0; i < hash->count; i++) {
-		if (!hash->done[i] && !memcmp(word_hash, &hash->hashes[i * SHA256_BLOCK_SIZE], SHA256_BLOCK_SIZE)) {
-			hash->done[i] = 1;
-
-			printf("%.*s %d\n", (int) len, word->word, i + 1);
-		}
-	}
-}
-
-
-void guess_set(Word *word, int len, const char *set, int set_len, long *remaining, Hash *hash) {
-	word_reset(word, len, set);
-	int changed = len;
-
-	// try the next guess from a set until we cant make any more guesses
-	while ((hash || *remaining > 0) && changed >= 0) {
-		if (changed < LEN_PWD_MAX) {
-			make_guess(word, LEN_PWD_MAX, remaining, hash);
-		}
-		changed = next_set(word, len, LEN_PWD_MAX, set, set_len);
-	}
-}
-
-int next_set(Word *word, int offset, int max, const char *set, int set_len) {
-	// increment the part of the word after offset to be the next in the set
-	for (int i = max - 1; i >= offset; i--) {
-		int index = (word->index[i] + 1) % set_len;
-		word->index[i] = index;
-		word->word[i] = set[index];
-
-		// index == 0 => we the next character can be incremented
-		if (index != 0) {
-			return i;
-		}
-	}
-
-	return -1;
-}
-
-void guess_set_dict(Word *word, const char *set, long *remaining, Hash *hash) {
-	FILE *fp = fopen(DICT_FILE, "r");
-	assert(fp);
-
-	// try each word in DICT_FILE with each permutaution of the set
-	while (!feof(fp) && (hash || *remaining > 0)) {
-		int len = read_line(fp, word);
-		if (len < LEN_PWD_MAX) {
-			guess_set(word, len, set, strlen(set), remaining, hash);
-		}
-	}
-	fclose(fp);
-}
-
-void make_guess(Word *word, int len, long *remaining, Hash *hash) {
-	// if we are checking against hashes
-	if (hash != NULL) {
-		check_hash(word, hash, len);
-		return;
-	}
-	// else, we are just printing
-	if (*remaining > 0) {
-		(*remaining)--;
-		printf("%.*s\n", len, word->word);
-	}
-}
-
-void generate_guesses(long count, char *sha_filename) {
-	int hashing = (sha_filename != NULL);
-
-	long remaining = count;
-
-	Word word;
-	word_init(&word);
-
-	// initialise a Hash if we are hashing, else we must be printing
-	Hash hash, *hash_ptr;
-	if (hashing) {
-		hash_ptr = &hash;
-		hash_init(hash_ptr, sha_filename);
-	} else {
-		hash_ptr = NULL;
-	}
-
-	// guess dictionary words
-	FILE *fp = fopen(DICT_FILE, "rb");
-	assert(fp);
-	while (!feof(fp) && (hash_ptr || remaining > 0)) {
-		int len = read_line(fp, &word);
-		if (len >= LEN_PWD_MAX) {
-			make_guess(&word, LEN_PWD_MAX, &remaining, hash_ptr);
-		}
-	}
-	fclose(fp);
-
-	guess_subs(&word, &remaining, hash_ptr);
-
-	// guess dictionary with various character sets appended at the end
-	guess_set_dict(&word, numbers, &remaining, hash_ptr);
-	guess_set_dict(&word, letters, &remaining, hash_ptr);
-	// guess_set_dict(&word, special, &remaining, hash_ptr);
-
-	// resort to brute force. this could take a while if we are hashing
-	if (hashing || remaining > 0) {
-		// letters are a little more likely
-		guess_set(&word, 0, letters, strlen(letters), &remaining, hash_ptr);
-		// true brute
-		guess_set(&word, 0, full, strlen(full), &remaining, hash_ptr);
-	}
-
-	// cleanup time
-	if (hashing) {
-		hash_free(hash_ptr);
-	}
-	word_free(&word);
-}
-
-void guess_subs(Word *word, long *remaining, Hash *hash) {
-	FILE *fp = fopen(DICT_FILE, "r");
-	assert(fp);
-
-	// try each word in DICT_FILE with each permutaution of the set
-	while (!feof(fp) && (hash || *remaining > 0)) {
-		int len = read_line(fp, word);
-		int count = 0;
-		if (len >= LEN_PWD_MAX) {
-			for (int i = 0; i < LEN_PWD_MAX; i++) {
-				int c = word->word[i];
-				if ('a' <= c && c <= 'z') {
-					word->index[i] = c - 'a';
-					count++;
-				} else {
-					word->index[i] = -1;
-				}
-			}
-
-			if (count > 0) {
-				next_sub(word, LEN_PWD_MAX, 0, 0, remaining, hash);
-			}
-		}
-	}
-
-	fclose(fp);
-}
-
-void next_sub(Word *word, int len, int index, int n_subs, long *remaining, Hash *hash) {
-	if (index >= len || n_subs >= MAX_SUBS) {
-		if (n_subs > 0) {
-			make_guess(word, len, remaining, hash);
-		}
-		return;
-	}
-
-	next_sub(word, len, index + 1, n_subs, remaining, hash);
-
-	int i = word->index[index];	
-	if (i >= 0) {
-		int sub_len = strlen(subs[i]);
-		for (int s = 0; s < sub_len; s++) {
-			word->word[index] = subs[i][s];
-			next_sub(word, len, index + 1, n_subs + 1, remaining, hash);
-		}
-
-		word->word[index] = letters[i];
-	}
-}
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sha256.h"
+#include "pool.h"
+#include "checkpoint.h"
+#include "pipeline.h"
+#include "dict.h"
+#include "rules.h"
+#include "mask.h"
+#include "markov.h"
+#include "seen.h"
+#include "hash.h"
+#include "emit.h"
+#include "digests.h"
+#include "quad.h"
+#include "stats.h"
+
+#define GROWTH_FACTOR 2
+
+#define PWD4SHA256  "pwd4sha256"
+#define PWD6SHA256  "pwd6sha256"
+#define PWDXSHA256  "pwdXsha256"
+
+#define DICT_FILE "dict.txt"
+// passwords the brute force learns which characters are likely from
+#define MARKOV_FILE "common_passwords.txt"
+// digests of every guess the dictionary phases make, rebuilt whenever its
+// fingerprint no longer matches the dictionary and rules
+#define DIGESTS_FILE "dict.digests"
+// bump whenever the dictionary phases change what they guess
+#define DIGESTS_VERSION 1
+// digests of every 4 character word, built by --build-quad
+#define QUAD_FILE "pwd4.quad"
+
+// hashing runs save their progress here every CHECKPOINT_INTERVAL seconds
+#define CHECKPOINT_FILE     "crack.ckpt"
+#ifndef CHECKPOINT_INTERVAL
+#define CHECKPOINT_INTERVAL 60
+#endif
+// brute force progress is noted whenever the odometer carries this far left
+#define CHECKPOINT_POS       3
+
+// phases the dictionary makes guesses in
+#define DICT_PHASES 4
+
+// word lists to check are read this much at a time
+#define TEST_BUFFER_SIZE (1 << 20)
+
+#define BRUTE_MODE 1
+#define GUESS_MODE 2
+#define TEST_MODE  3
+
+#define LEN_PWD_MIN    4
+#define LEN_PWD_MAX    6
+#define CHAR_PWD_MIN  32
+#define CHAR_PWD_MAX 126
+
+// guessing phases are split into units for the worker pool: runs of
+// DICT_UNIT lines of the dictionary, or the first MASK_UNIT_LEN characters
+// of a mask. printed masks fix more, as a worker can only get so far ahead
+// of the unit being written
+#define DICT_UNIT          128
+#define MASK_UNIT_LEN        2
+#define EMIT_MASK_UNIT_LEN   4
+
+#if LEN_PWD_MAX > BATCH_WORD_MAX
+#error "guesses must fit in a batch"
+#endif
+#if LEN_PWD_MAX > HASH_LEN_MAX
+#error "guesses must fit in the target tables"
+#endif
+#if LEN_PWD_MAX > DIGESTS_WORD_MAX
+#error "guesses must fit in the digest table"
+#endif
+#if LEN_PWD_MIN != QUAD_LEN
+#error "the shortest guesses must be the ones indexed"
+#endif
+
+// what a phase does about guesses earlier phases made: nothing, or skip them
+#define DEDUP_NONE 0
+#define DEDUP_SKIP 1
+
+// remnants of an old brute force solution
+#define NEXT_CHAR(C) (((((C) - CHAR_PWD_MIN + 1) % \
+(CHAR_PWD_MAX - CHAR_PWD_MIN + 1)) + CHAR_PWD_MIN))
+#define CARRIED_CHAR(C) ((C) == CHAR_PWD_MIN)
+
+typedef struct {
+	char *word;
+	int *index;
+	int alloc;
+	// guesses made but not yet handed to the pipeline, if any
+	Batch *batch;
+	// what the phase the word is in does about guesses already made
+	Seen *seen;
+	int dedup;
+	// where guesses are written when printing, and the worker the word is for
+	Emit *emit;
+	int worker;
+	// where the worker counts its guesses, if anywhere
+	StatsSlot *stats;
+} Word;
+
+// settings from the command line
+typedef struct {
+	int threads;
+	// threads hashing batches of guesses, 0 to hash in the workers making them
+	int hashers;
+	// files of targets to hash against, and the word length each is for
+	char **targets;
+	int *target_lens;
+	int n_targets;
+	int resume;
+	// rule file to mangle the dictionary with, NULL for the default rules
+	char *rules;
+	// this process guesses every shards'th unit of each phase, from shard
+	int shard, shards;
+	// masks to guess instead of the usual phases, and their custom sets
+	char **masks;
+	int n_masks;
+	char *custom[MASK_CUSTOM];
+	// bits of each digest to keep when building the 4 character index, and
+	// a file of targets to look up in it
+	int quad_bits;
+	char *quad;
+	// seconds between progress reports to stderr, 0 for none, and a file
+	// (or - for stderr) the counts of every phase are written to at the end
+	int status;
+	char *stats;
+	// targets already cracked are read from here, and new ones added to it
+	char *potfile;
+} Options;
+
+// a phase of guessing, shared by the workers running its units
+typedef struct Phase Phase;
+struct Phase {
+	// runs a unit of the phase, picking up from resume if it is not NULL
+	void (*guess_unit)(Phase *phase, long unit, int worker, const int *resume);
+	// guesses based on a single dictionary word, line. word holds at least
+	// its first LEN_PWD_MAX characters
+	void (*guess_word)(Phase *phase, Word *word, const char *line, int len);
+	int number;
+	int shard, shards;
+	Checkpoint *checkpoint;
+	const char *set;
+	int set_len;
+	Mask *mask;
+	// how many leading positions of the mask a unit fixes
+	int mask_unit_len;
+	Markov *markov;
+	int level;
+	// the targets when hashing, to skip phases of words none can match
+	Hash *hash;
+	// guesses already made, and what the phase does about them
+	Seen *seen;
+	int dedup;
+	Dict *dict;
+	Rules *rules;
+	Pipeline *pipe;
+	// writes printed guesses in order, NULL when hashing
+	Emit *emit;
+	Word *words;
+	// what the phase is called and how many guesses it makes, if known, for
+	// counting its progress, if anything is
+	char name[STATS_NAME_MAX];
+	unsigned long long keyspace;
+	Stats *stats;
+};
+
+// builds QUAD_FILE across threads, keeping bits of each digest
+void build_quad(int bits, int threads);
+// prints the 4 character word for every target in sha_filename there is one
+// for, from QUAD_FILE
+void lookup_quad(char *sha_filename, int threads);
+// looks every target up in QUAD_FILE, returning 0 if there is none
+int join_quad(Hash *hash, Pool *pool);
+// skips the targets already cracked in opts->potfile, if there is one
+void load_potfile(Hash *hash, Options *opts);
+
+// checks every line of pwd_filename, or stdin if it is "-", against the
+// hashes in sha_filename
+void test_passwords(char *pwd_filename, char *sha_filename, Options *opts);
+// checks a line of a word list, adding it to batch if it fits
+void test_line(Hash *hash, Pipeline *pipe, Batch **batch, const char *line, int len);
+
+void print_sha256(BYTE *hash);
+
+void word_init(Word *word);
+void word_free(Word *word);
+void word_reset(Word *word, int min, const char *set);
+
+// generates up to count guesses if there are no target files in opts,
+// else generates and checkes guesses against the hashes
+void generate_guesses(long count, Options *opts);
+
+// guesses a short dictionary word with each permutation of the set appended
+void guess_set_dict(Phase *phase, Word *word, const char *line, int len);
+// makes a guess, adding it to the word's batch for the pipeline
+void make_guess(Word *word, int len, Pipeline *pipe);
+// hands whatever is in the word's batch over to the pipeline
+void word_flush(Word *word, Pipeline *pipe);
+// guesses a long enough dictionary word as is
+void guess_dict(Phase *phase, Word *word, const char *line, int len);
+// guesses whatever the rules make of a dictionary word
+void guess_rules(Phase *phase, Word *word, const char *line, int len);
+
+// runs this shard's units of a phase across the pool, skipping any a
+// resumed run has already done
+void run_phase(Pool *pool, Phase *phase, long units);
+void run_unit(void *arg, long unit, int worker);
+// runs units of a printing phase for worker in the order they are written
+void run_emit_units(void *arg, long job, int worker);
+// skips a phase of words len long if no target could be one, returning 1
+int phase_skip(Phase *phase, int len);
+// runs every phase made from the dictionary, DICT_PHASES of them
+void run_dict_phases(Pool *pool, Phase *phase);
+// checks the targets against the digests of every guess run_dict_phases
+// makes, building the table first if it is missing or out of date
+void join_dict_digests(Pool *pool, Phase *phase);
+// what the digest table of the dictionary phases was made from
+uint64_t dict_fingerprint(Phase *phase);
+// sink for the pipeline, adding a batch of guesses to a digest table
+void digest_batch(void *arg, Batch *batch);
+// runs phase->guess_word over every word in the dictionary
+void run_dict_phase(Pool *pool, Phase *phase);
+void guess_dict_unit(Phase *phase, long unit, int worker, const int *resume);
+// guesses every word phase->mask makes
+void run_mask_phase(Pool *pool, Phase *phase);
+void guess_mask_unit(Phase *phase, long unit, int worker, const int *resume);
+// guesses every word of total level phase->level, most likely first
+void run_markov_phase(Pool *pool, Phase *phase);
+void guess_markov_unit(Phase *phase, long unit, int worker, const int *resume);
+
+// various subsets of characters
+static const char *letters = "abcdefghijklmnopqrstuvwxyz";
+static const char *numbers = "0123456789";
+// static const char *special = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+// mangling applied to the dictionary when no rule file is given: common
+// substitutions (e.g. 1337) of up to 3 letters in the first LEN_PWD_MAX
+// characters of long enough words
+static const char *default_rules =
+	"=aA@&\n=bB68\n=cC[(<\n=dD])>?\n=eE3\n=fF#\n=gG9\n=hH#\n=iI1|!\n"
+	"=jJ\n=kK<\n=lL7\n=mM\n=nN^\n=oO0*\n=pP?\n=qQ9\n=rR\n"
+	"=sS5$2\n=tT+\n=uU\n=vV\n=wW\n=xX%\n=yY\n=zZ2\n"
+	">5 '6 %3\n";
+
+int main(int argc, char *argv[]) {
+	char *masks[argc], *targets[argc];
+	int target_lens[argc];
+	Options opts;
+	opts.threads = 1;
+	opts.hashers = 0;
+	opts.targets = targets;
+	opts.target_lens = target_lens;
+	opts.n_targets = 0;
+	opts.resume = 0;
+	opts.rules = NULL;
+	opts.masks = masks;
+	opts.n_masks = 0;
+	for (int i = 0; i < MASK_CUSTOM; i++) {
+		opts.custom[i] = NULL;
+	}
+	opts.shard = 0;
+	opts.shards = 1;
+	opts.quad_bits = 0;
+	opts.quad = NULL;
+	opts.status = 0;
+	opts.stats = NULL;
+	opts.potfile = NULL;
+
+	// pull the options out, leaving the arguments that pick the mode
+	char *args[argc];
+	int n_args = 0, ok = 1;
+	for (int i = 0; i < argc; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+			opts.threads = strtol(argv[++i], NULL, 10);
+			ok &= opts.threads >= 1;
+		} else if (!strcmp(argv[i], "--hashers") && i + 1 < argc) {
+			opts.hashers = strtol(argv[++i], NULL, 10);
+			ok &= opts.hashers >= 0;
+		} else if (!strcmp(argv[i], "--targets") && i + 1 < argc) {
+			// a file of digests, then optionally :len for the length of word
+			// they are for
+			char *file = argv[++i], *colon = strrchr(file, ':'), *end;
+			target_lens[opts.n_targets] = 0;
+			if (colon) {
+				long len = strtol(colon + 1, &end, 10);
+				if (end != colon + 1 && !*end) {
+					ok &= 1 <= len && len <= LEN_PWD_MAX;
+					target_lens[opts.n_targets] = len;
+					*colon = '\0';
+				}
+			}
+			targets[opts.n_targets++] = file;
+		} else if (!strcmp(argv[i], "--rules") && i + 1 < argc) {
+			opts.rules = argv[++i];
+		} else if (!strcmp(argv[i], "--mask") && i + 1 < argc) {
+			masks[opts.n_masks++] = argv[++i];
+		} else if (argv[i][0] == '-' && '1' <= argv[i][1] && argv[i][1] < '1' + MASK_CUSTOM
+		           && !argv[i][2] && i + 1 < argc) {
+			// a custom set for masks, -1 to -4
+			int set = argv[i][1] - '1';
+			opts.custom[set] = argv[++i];
+		} else if (!strcmp(argv[i], "--build-quad") && i + 1 < argc) {
+			opts.quad_bits = strtol(argv[++i], NULL, 10);
+			ok &= opts.quad_bits == 8 || opts.quad_bits == 16 || opts.quad_bits == 32;
+		} else if (!strcmp(argv[i], "--quad") && i + 1 < argc) {
+			opts.quad = argv[++i];
+		} else if (!strcmp(argv[i], "--status") && i + 1 < argc) {
+			opts.status = strtol(argv[++i], NULL, 10);
+			ok &= opts.status >= 1;
+		} else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+			opts.stats = argv[++i];
+		} else if (!strcmp(argv[i], "--potfile") && i + 1 < argc) {
+			opts.potfile = argv[++i];
+		} else if (!strcmp(argv[i], "--resume")) {
+			opts.resume = 1;
+		} else if (!strcmp(argv[i], "--shard") && i + 1 < argc) {
+			// numbered from 1, as in 1/4 .. 4/4
+			ok &= sscanf(argv[++i], "%d/%d", &opts.shard, &opts.shards) == 2
+			      && 1 <= opts.shard && opts.shard <= opts.shards;
+			opts.shard--;
+		} else {
+			args[n_args++] = argv[i];
+		}
+	}
+	if (!ok) {
+		n_args = 0;
+	}
+
+	// the 4 character index is built or looked in on its own
+	if (ok && n_args == 1 && (opts.quad_bits || opts.quad)) {
+		if (opts.quad_bits) {
+			build_quad(opts.quad_bits, opts.threads);
+		}
+		if (opts.quad) {
+			lookup_quad(opts.quad, opts.threads);
+		}
+		exit(EXIT_SUCCESS);
+	}
+
+	switch (n_args) {
+	case BRUTE_MODE:
+		// this one could take a very long time. which it did :(
+		if (opts.n_targets == 0) {
+			targets[0] = PWDXSHA256;
+			target_lens[0] = 0;
+			opts.n_targets = 1;
+		}
+		generate_guesses(-1, &opts);
+		break;
+	case GUESS_MODE:
+		opts.n_targets = 0;
+		generate_guesses(strtol(args[1], NULL, 10), &opts);
+		break;
+	case TEST_MODE:
+		test_passwords(args[1], args[2], &opts);
+		break;
+	default:
+		printf("USAGE: <program> [-j <threads : int>] [--hashers <threads : int>] " \
+		       "[--targets <hashes_file[:len]> ...] [--rules <rules_file : string>] " \
+		       "[--mask <mask : string> ...] [-1 .. -4 <set : string>] [--resume] [--shard <k/n>] " \
+		       "[--status <seconds : int>] [--stats <json_file : string | ->] [--potfile <found_file : string>] " \
+		       "[--build-quad <bits : 8|16|32>] [--quad <hashes_file : string>] [<n_words : int> " \
+		       "| <words_file : string | -> <hashes_file : string>]\n");
+		exit(EXIT_FAILURE);
+	}
+
+	exit(EXIT_SUCCESS);
+
+	return 0;
+}
+
+void build_quad(int bits, int threads) {
+	Pool pool;
+	pool_init(&pool, threads);
+
+	fprintf(stderr, "%s: building, %ld bytes\n", QUAD_FILE, QUAD_WORDS * (bits / 8));
+	if (quad_build(QUAD_FILE, bits, &pool) < 0) {
+		perror(QUAD_FILE);
+		exit(EXIT_FAILURE);
+	}
+
+	pool_free(&pool);
+}
+
+void lookup_quad(char *sha_filename, int threads) {
+	Hash hash;
+	int len = QUAD_LEN;
+	hash_init(&hash, &sha_filename, &len, 1);
+
+	Pool pool;
+	pool_init(&pool, threads);
+
+	if (!join_quad(&hash, &pool)) {
+		fprintf(stderr, "%s: no index, build one with --build-quad\n", QUAD_FILE);
+		exit(EXIT_FAILURE);
+	}
+
+	pool_free(&pool);
+	hash_free(&hash);
+}
+
+// checks a word the index found in the usual way, so it is printed and
+// marked as it would be if it had been guessed
+static void quad_found(void *arg, int target, const char *word) {
+	check_word(arg, word, QUAD_LEN);
+}
+
+void load_potfile(Hash *hash, Options *opts) {
+	if (!opts->potfile) {
+		return;
+	}
+
+	int marked = hash_potfile(hash, opts->potfile);
+	if (marked < 0) {
+		perror(opts->potfile);
+		exit(EXIT_FAILURE);
+	}
+	if (marked > 0) {
+		fprintf(stderr, "%s: %d of %d targets already cracked\n", opts->potfile, marked, hash->count);
+	}
+}
+
+int join_quad(Hash *hash, Pool *pool) {
+	Quad quad;
+	if (!quad_load(&quad, QUAD_FILE)) {
+		return 0;
+	}
+
+	quad_find(&quad, hash->hashes, hash->count, quad_found, hash, pool);
+	quad_free(&quad);
+
+	return 1;
+}
+
+void test_passwords(char *pwd_filename, char *sha_filename, Options *opts) {
+	Hash hash;
+	int any_len = 0;
+	hash_init(&hash, &sha_filename, &any_len, 1);
+
+	int fd = strcmp(pwd_filename, "-") ? open(pwd_filename, O_RDONLY) : STDIN_FILENO;
+	if (fd < 0) {
+		perror(pwd_filename);
+		exit(EXIT_FAILURE);
+	}
+
+	// lines are hashed in batches, by --hashers threads if there are any
+	Pipeline pipe;
+	pipeline_init(&pipe, 1, opts->hashers, -1, check_batch, &hash);
+	Batch *batch = NULL;
+	// reading stops once every target is cracked
+	hash.pipe = &pipe;
+	load_potfile(&hash, opts);
+
+	// read in big blocks, splitting out whole lines where they sit and
+	// carrying any part line over to the next block
+	size_t size = TEST_BUFFER_SIZE, len = 0;
+	char *buf = malloc(size);
+	assert(buf);
+	while (pipeline_more(&pipe)) {
+		ssize_t n = read(fd, buf + len, size - len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			if (n < 0) {
+				perror(pwd_filename);
+			}
+			// a last line with no newline is still a line
+			if (len > 0) {
+				test_line(&hash, &pipe, &batch, buf, len);
+			}
+			break;
+		}
+		len += n;
+
+		char *line = buf, *end = buf + len, *newline;
+		while ((newline = memchr(line, '\n', end - line))) {
+			test_line(&hash, &pipe, &batch, line, newline - line);
+			line = newline + 1;
+		}
+
+		len = end - line;
+		memmove(buf, line, len);
+		// a line longer than the buffer makes it grow
+		if (len == size) {
+			size *= GROWTH_FACTOR;
+			buf = realloc(buf, size);
+			assert(buf);
+		}
+	}
+
+	if (batch) {
+		pipeline_put(&pipe, batch);
+	}
+	pipeline_free(&pipe);
+
+	if (fd != STDIN_FILENO) {
+		close(fd);
+	}
+	free(buf);
+	hash_free(&hash);
+}
+
+void test_line(Hash *hash, Pipeline *pipe, Batch **batch, const char *line, int len) {
+	// too long for a batch, so on its own after the lines before it
+	if (len > BATCH_WORD_MAX) {
+		if (*batch) {
+			pipeline_put(pipe, *batch);
+			*batch = NULL;
+		}
+		check_word(hash, line, len);
+		return;
+	}
+
+	if (!*batch) {
+		*batch = pipeline_get(pipe);
+	}
+	memcpy(&(*batch)->words[(*batch)->count * BATCH_WORD_MAX], line, len);
+	(*batch)->len[(*batch)->count++] = len;
+
+	if ((*batch)->count == BATCH_SIZE) {
+		pipeline_put(pipe, *batch);
+		*batch = NULL;
+	}
+}
+
+void print_sha256(BYTE *hash) {
+	for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+		printf("%02x", hash[i]);
+	}
+}
+
+void word_init(Word *word) {
+	word->word = malloc(sizeof(char) * LEN_PWD_MAX);
+	word->index = malloc(sizeof(int) * LEN_PWD_MAX);
+	assert(word->word && word->index);
+
+	word->alloc = LEN_PWD_MAX;
+	word->batch = NULL;
+	word->seen = NULL;
+	word->dedup = DEDUP_NONE;
+	word->emit = NULL;
+	word->worker = 0;
+	word->stats = NULL;
+
+	word_reset(word, 0, letters);
+}
+
+void word_free(Word *word) {
+	free(word->word);
+	free(word->index);
+}
+
+void word_reset(Word *word, int min, const char *set) {
+	for (int i = min; i < LEN_PWD_MAX; i++) {
+		word->index[i] = 0;
+		word->word[i] = set[0];
+	}
+}
+
+void guess_set(Word *word, int len, const char *set, int set_len, Pipeline *pipe) {
+	word_reset(word, len, set);
+	int changed = len;
+
+	// try the next guess from a set until we cant make any more guesses
+	while (pipeline_more(pipe) && changed >= 0) {
+		if (changed < LEN_PWD_MAX) {
+			make_guess(word, LEN_PWD_MAX, pipe);
+		}
+		changed = next_set(word->word, word->index, len, LEN_PWD_MAX, set, set_len);
+	}
+}
+
+void guess_set_dict(Phase *phase, Word *word, const char *line, int len) {
+	if (len < LEN_PWD_MAX) {
+		guess_set(word, len, phase->set, phase->set_len, phase->pipe);
+	}
+}
+
+void make_guess(Word *word, int len, Pipeline *pipe) {
+	if (word->stats) {
+		// only this worker writes its slot, so no need for the slower add
+		__atomic_store_n(&word->stats->guesses, word->stats->guesses + 1, __ATOMIC_RELAXED);
+	}
+
+	if (word->dedup != DEDUP_NONE) {
+		if (seen_has(word->seen, word->word, len)) {
+			return;
+		}
+	}
+
+	if (word->emit) {
+		if (!emit_word(word->emit, word->worker, word->word, len)) {
+			pipeline_stop(pipe);
+		}
+		return;
+	}
+
+	if (!pipeline_take(pipe)) {
+		return;
+	}
+
+	if (!word->batch) {
+		word->batch = pipeline_get(pipe);
+	}
+	Batch *batch = word->batch;
+	memcpy(&batch->words[batch->count * BATCH_WORD_MAX], word->word, len);
+	batch->len[batch->count++] = len;
+
+	if (batch->count == BATCH_SIZE) {
+		word_flush(word, pipe);
+	}
+}
+
+void word_flush(Word *word, Pipeline *pipe) {
+	if (word->batch) {
+		pipeline_put(pipe, word->batch);
+		word->batch = NULL;
+	}
+}
+
+// lets a checkpoint wait out batches still being hashed
+static void drain_pipeline(void *arg) {
+	pipeline_flush(arg);
+}
+
+// compiles a mask of len positions all from the built in set ?set, leaving
+// its source in source
+static void brute_mask(Mask *mask, int len, char set, char *source) {
+	for (int i = 0; i < len; i++) {
+		source[2 * i] = '?';
+		source[2 * i + 1] = set;
+	}
+	source[2 * len] = '\0';
+	mask_compile(mask, source, NULL);
+}
+
+void generate_guesses(long count, Options *opts) {
+	int hashing = opts->n_targets > 0;
+	int threads = opts->threads;
+
+	// given a model of real passwords, true brute force goes most likely first
+	Markov *markov = NULL;
+	if (opts->n_masks == 0) {
+		markov = malloc(sizeof(Markov));
+		assert(markov);
+		if (markov_train(markov, MARKOV_FILE, LEN_PWD_MAX) < 0) {
+			free(markov);
+			markov = NULL;
+		}
+	}
+
+	// the masks asked for, else the brute force that follows the dictionary
+	int n_masks = opts->n_masks;
+	Mask *masks = malloc(sizeof(Mask) * (n_masks > 0 ? n_masks : 3));
+	assert(masks);
+	char brute_sources[3][2 * LEN_PWD_MAX + 1];
+	char **sources = n_masks > 0 ? opts->masks : (char *[]) {
+		brute_sources[0], brute_sources[1], brute_sources[2]
+	};
+	if (opts->n_masks > 0) {
+		unsigned long long total = 0;
+		for (int i = 0; i < n_masks; i++) {
+			if (mask_compile(&masks[i], opts->masks[i], opts->custom) < 0
+			    || masks[i].len > LEN_PWD_MAX) {
+				fprintf(stderr, "%s: bad mask\n", opts->masks[i]);
+				exit(EXIT_FAILURE);
+			}
+			unsigned long long keyspace = mask_keyspace(&masks[i]);
+			fprintf(stderr, "%s: %llu guesses\n", opts->masks[i], keyspace);
+			total += keyspace;
+		}
+		fprintf(stderr, "total: %llu guesses\n", total);
+	} else {
+		// short words are few enough to try every one first, when hashing.
+		// then letters are a little more likely, then true brute if not by
+		// markov
+		if (hashing) {
+			brute_mask(&masks[n_masks], LEN_PWD_MIN, 'a', sources[n_masks]);
+			n_masks++;
+		}
+		brute_mask(&masks[n_masks], LEN_PWD_MAX, 'l', sources[n_masks]);
+		n_masks++;
+		if (!markov) {
+			brute_mask(&masks[n_masks], LEN_PWD_MAX, 'a', sources[n_masks]);
+			n_masks++;
+		}
+	}
+
+	// initialise a Hash if we are hashing, else we must be printing.
+	// guesses go through the pipeline in batches to whichever it is
+	Hash hash, *hash_ptr;
+	Emit emit, *emit_ptr;
+	Pipeline pipe;
+	if (hashing) {
+		hash_ptr = &hash;
+		emit_ptr = NULL;
+		hash_init(hash_ptr, opts->targets, opts->target_lens, opts->n_targets);
+		pipeline_init(&pipe, threads, opts->hashers, -1, check_batch, hash_ptr);
+		// the run is over once every target is cracked
+		hash.pipe = &pipe;
+		load_potfile(hash_ptr, opts);
+	} else {
+		hash_ptr = NULL;
+		// printed guesses skip the pipeline, which just tells workers when
+		// the emitter has had enough
+		emit_ptr = &emit;
+		emit_init(emit_ptr, STDOUT_FILENO, threads, count > 0 ? count : 0);
+		pipeline_init(&pipe, threads, 0, -1, NULL, NULL);
+	}
+
+	Pool pool;
+	pool_init(&pool, threads);
+
+	// counting is left out of the hot paths unless asked for
+	Stats stats, *stats_ptr = NULL;
+	if (opts->status || opts->stats) {
+		stats_ptr = &stats;
+		stats_init(stats_ptr, threads);
+		if (hashing) {
+			hash.stats = stats_ptr;
+		}
+		if (opts->status) {
+			stats_start(stats_ptr, opts->status);
+		}
+	}
+
+	Word *words = malloc(sizeof(Word) * threads);
+	assert(words);
+	for (int i = 0; i < threads; i++) {
+		word_init(&words[i]);
+		words[i].emit = emit_ptr;
+		words[i].worker = i;
+		words[i].stats = stats_ptr ? &stats.slots[i] : NULL;
+	}
+
+	// every dictionary phase shares the one copy
+	Dict dict;
+	dict_init(&dict, DICT_FILE);
+
+	Rules rules;
+	rules_init(&rules);
+	int err = opts->rules ? rules_load(&rules, opts->rules) : rules_compile(&rules, default_rules);
+	if (err) {
+		if (err < 0) {
+			perror(opts->rules);
+		} else {
+			fprintf(stderr, "%s: line %d: bad rule\n", opts->rules, err);
+		}
+		exit(EXIT_FAILURE);
+	}
+
+	// hashing skips guesses it has already made
+	Seen seen, *seen_ptr = NULL;
+	if (hashing) {
+		seen_ptr = &seen;
+		seen_init(seen_ptr);
+	}
+
+	// only hashing is worth picking back up after a crash
+	Checkpoint checkpoint, *checkpoint_ptr = NULL;
+	char filename[64];
+	if (hashing) {
+		checkpoint_ptr = &checkpoint;
+		// each shard keeps its own
+		if (opts->shards > 1) {
+			sprintf(filename, "%s.%d-%d", CHECKPOINT_FILE, opts->shard + 1, opts->shards);
+		} else {
+			strcpy(filename, CHECKPOINT_FILE);
+		}
+
+		checkpoint_init(checkpoint_ptr, filename, threads, hash.count, LEN_PWD_MAX);
+		if (opts->resume && checkpoint_load(checkpoint_ptr)) {
+			for (int i = 0; i < hash.count; i++) {
+				if (checkpoint.found[i]) {
+					hash_mark(hash_ptr, i);
+				}
+			}
+		}
+		hash.checkpoint = checkpoint_ptr;
+		checkpoint.drain = drain_pipeline;
+		checkpoint.drain_arg = &pipe;
+		checkpoint_start(checkpoint_ptr, CHECKPOINT_INTERVAL);
+	}
+
+	Phase phase;
+	phase.number = 0;
+	phase.shard = opts->shard;
+	phase.shards = opts->shards;
+	phase.checkpoint = checkpoint_ptr;
+	phase.hash = hash_ptr;
+	phase.seen = seen_ptr;
+	phase.dedup = DEDUP_NONE;
+	phase.dict = &dict;
+	phase.rules = &rules;
+	phase.pipe = &pipe;
+	phase.emit = emit_ptr;
+	phase.words = words;
+	phase.mask_unit_len = hashing ? MASK_UNIT_LEN : EMIT_MASK_UNIT_LEN;
+	phase.keyspace = 0;
+	phase.stats = stats_ptr;
+
+	if (opts->n_masks == 0) {
+		// the dictionary makes the same guesses every run, so when hashing
+		// their digests are looked up instead
+		if (hashing) {
+			if (pipeline_more(&pipe)) {
+				join_dict_digests(&pool, &phase);
+			}
+		} else {
+			run_dict_phases(&pool, &phase);
+		}
+	}
+
+	// resort to brute force, or whatever masks were asked for. this could
+	// take a while if we are hashing
+	phase.dedup = hashing ? DEDUP_SKIP : DEDUP_NONE;
+	int first = 0;
+	if (hashing && opts->n_masks == 0 && pipeline_more(&pipe)) {
+		// the first brute force mask is every 4 character word, which an
+		// index may have already. only the first shard reports from it
+		if (stats_ptr) {
+			stats_phase(stats_ptr, "index ?a?a?a?a", 1, 0);
+		}
+		// every shard must come to the same answer, so the others check the
+		// index loads just as the first does, rather than that it is there
+		int indexed = 0;
+		if (phase.shard == 0) {
+			indexed = join_quad(hash_ptr, &pool);
+		} else {
+			Quad quad;
+			if (quad_load(&quad, QUAD_FILE)) {
+				quad_free(&quad);
+				indexed = 1;
+			}
+		}
+		if (indexed) {
+			seen_mask(seen_ptr, &masks[0]);
+			phase.number++;
+			first = 1;
+		}
+		if (stats_ptr) {
+			stats_unit(stats_ptr);
+			stats_end(stats_ptr);
+		}
+	}
+	for (int i = first; i < n_masks && pipeline_more(&pipe); i++) {
+		phase.mask = &masks[i];
+		snprintf(phase.name, STATS_NAME_MAX, "mask %s", sources[i]);
+		run_mask_phase(&pool, &phase);
+		// later phases need not try anything in it again
+		if (hashing) {
+			seen_mask(seen_ptr, &masks[i]);
+		}
+	}
+	phase.markov = markov;
+	for (int level = markov ? markov_least(markov) : 0;
+	     markov && level <= markov_most(markov) && pipeline_more(&pipe); level++) {
+		phase.level = level;
+		run_markov_phase(&pool, &phase);
+	}
+
+	// cleanup time
+	if (stats_ptr) {
+		if (opts->stats && stats_json(stats_ptr, opts->stats) < 0) {
+			perror(opts->stats);
+		}
+		stats_free(stats_ptr);
+	}
+	// the final checkpoint waits out the pipeline, so goes before it
+	if (hashing) {
+		checkpoint_free(checkpoint_ptr);
+	}
+	pipeline_free(&pipe);
+	dict_free(&dict);
+	rules_free(&rules);
+	free(masks);
+	free(markov);
+	if (hashing) {
+		seen_free(seen_ptr);
+		hash_free(hash_ptr);
+	} else {
+		emit_free(emit_ptr);
+	}
+	for (int i = 0; i < threads; i++) {
+		word_free(&words[i]);
+	}
+	free(words);
+	pool_free(&pool);
+}
+
+void guess_dict(Phase *phase, Word *word, const char *line, int len) {
+	if (len >= LEN_PWD_MAX) {
+		make_guess(word, LEN_PWD_MAX, phase->pipe);
+	}
+}
+
+void run_phase(Pool *pool, Phase *phase, long units) {
+	// this shard gets units shard, shard + shards, ...
+	long own = (units - phase->shard + phase->shards - 1) / phase->shards;
+	own = own > 0 ? own : 0;
+
+	if (phase->stats) {
+		// this shard's share of the guesses, roughly
+		stats_phase(phase->stats, phase->name, own, phase->keyspace / phase->shards);
+	}
+
+	if (phase->emit) {
+		// every worker takes units in turn, so none gets far ahead of the
+		// one being written
+		emit_phase(phase->emit, own);
+		pool_run(pool, pool->count, run_emit_units, phase);
+	} else if (!phase->checkpoint || checkpoint_phase(phase->checkpoint, phase->number, own)) {
+		pool_run(pool, own, run_unit, phase);
+		// the phase is not over until its guesses are
+		pipeline_flush(phase->pipe);
+	}
+	phase->number++;
+
+	if (phase->stats) {
+		stats_end(phase->stats);
+	}
+}
+
+void run_emit_units(void *arg, long job, int worker) {
+	Phase *phase = arg;
+	for (long own; (own = emit_claim(phase->emit, worker)) >= 0;) {
+		run_unit(phase, own, worker);
+		emit_end(phase->emit, worker);
+	}
+	// nothing more is wanted, so later phases need not start
+	if (!emit_more(phase->emit)) {
+		pipeline_stop(phase->pipe);
+	}
+}
+
+int phase_skip(Phase *phase, int len) {
+	if (phase->hash && !hash_wants(phase->hash, len)) {
+		// still numbered, so checkpoints line up whatever is skipped
+		phase->number++;
+		return 1;
+	}
+	return 0;
+}
+
+void run_unit(void *arg, long own, int worker) {
+	Phase *phase = arg;
+	Checkpoint *checkpoint = phase->checkpoint;
+	long unit = phase->shard + own * phase->shards;
+
+	phase->words[worker].seen = phase->seen;
+	phase->words[worker].dedup = phase->dedup;
+
+	if (!checkpoint) {
+		phase->guess_unit(phase, unit, worker, NULL);
+		word_flush(&phase->words[worker], phase->pipe);
+	} else {
+		int index[CHECKPOINT_WORD_MAX];
+		int resumed = checkpoint_begin(checkpoint, worker, own, index);
+		if (resumed >= 0) {
+			phase->guess_unit(phase, unit, worker, resumed ? index : NULL);
+			word_flush(&phase->words[worker], phase->pipe);
+			checkpoint_end(checkpoint, worker);
+		}
+	}
+
+	if (phase->stats) {
+		stats_unit(phase->stats);
+	}
+}
+
+void run_dict_phases(Pool *pool, Phase *phase) {
+	// guess dictionary words
+	phase->guess_word = guess_dict;
+	strcpy(phase->name, "dictionary");
+	run_dict_phase(pool, phase);
+
+	phase->guess_word = guess_rules;
+	strcpy(phase->name, "dictionary rules");
+	run_dict_phase(pool, phase);
+
+	// guess dictionary with various character sets appended at the end
+	phase->guess_word = guess_set_dict;
+	phase->set = numbers;
+	phase->set_len = strlen(numbers);
+	strcpy(phase->name, "dictionary + numbers");
+	run_dict_phase(pool, phase);
+	phase->set = letters;
+	phase->set_len = strlen(letters);
+	strcpy(phase->name, "dictionary + letters");
+	run_dict_phase(pool, phase);
+	// phase->set = special;
+}
+
+void join_dict_digests(Pool *pool, Phase *phase) {
+	Digests digests;
+	digests_init(&digests, dict_fingerprint(phase));
+
+	// the table is the same for every shard, so just the first uses it
+	if (phase->shard == 0 && !digests_load(&digests, DIGESTS_FILE)) {
+		fprintf(stderr, "%s: building\n", DIGESTS_FILE);
+
+		// every guess, whatever the targets, hashed by the workers making them
+		Pipeline pipe;
+		pipeline_init(&pipe, pool->count, 0, -1, digest_batch, &digests);
+		Phase build = *phase;
+		build.shard = 0;
+		build.shards = 1;
+		build.checkpoint = NULL;
+		build.hash = NULL;
+		build.seen = NULL;
+		build.dedup = DEDUP_NONE;
+		build.pipe = &pipe;
+		run_dict_phases(pool, &build);
+		pipeline_free(&pipe);
+
+		if (digests_save(&digests, DIGESTS_FILE) < 0) {
+			perror(DIGESTS_FILE);
+		}
+	}
+
+	if (phase->stats) {
+		stats_phase(phase->stats, "dictionary digests", 1, 0);
+	}
+
+	Hash *hash = phase->hash;
+	char word[DIGESTS_WORD_MAX];
+	for (int i = 0; i < hash->count; i++) {
+		int len = digests_find(&digests, &hash->hashes[i * SHA256_BLOCK_SIZE], word);
+		if (len >= 0) {
+			check_word(hash, word, len);
+		}
+	}
+
+	// later phases need not hash them again
+	for (long i = 0; phase->seen && i < digests.count; i++) {
+		seen_add(phase->seen, digests.entries[i].word, digests.entries[i].len);
+	}
+
+	// still numbered, so checkpoints line up with runs that hashed them
+	phase->number += DICT_PHASES;
+
+	if (phase->stats) {
+		stats_unit(phase->stats);
+		stats_end(phase->stats);
+	}
+
+	digests_free(&digests);
+}
+
+uint64_t dict_fingerprint(Phase *phase) {
+	Dict *dict = phase->dict;
+	Rules *rules = phase->rules;
+	int version = DIGESTS_VERSION, len = LEN_PWD_MAX;
+
+	uint64_t fingerprint = digests_fingerprint(0, &version, sizeof(version));
+	fingerprint = digests_fingerprint(fingerprint, &len, sizeof(len));
+	fingerprint = digests_fingerprint(fingerprint, dict->data, dict->size);
+	fingerprint = digests_fingerprint(fingerprint, rules->ops, sizeof(RuleOp) * rules->n_ops);
+	fingerprint = digests_fingerprint(fingerprint, rules->n_subs, sizeof(rules->n_subs));
+	for (int c = 0; c < 256; c++) {
+		fingerprint = digests_fingerprint(fingerprint, rules->subs[c], rules->n_subs[c]);
+	}
+	fingerprint = digests_fingerprint(fingerprint, numbers, strlen(numbers));
+	fingerprint = digests_fingerprint(fingerprint, letters, strlen(letters));
+	return fingerprint;
+}
+
+void digest_batch(void *arg, Batch *batch) {
+	digests_add(arg, batch->words, BATCH_WORD_MAX, batch->len, batch->count);
+}
+
+void run_dict_phase(Pool *pool, Phase *phase) {
+	long units = (phase->dict->count + DICT_UNIT - 1) / DICT_UNIT;
+	phase->guess_unit = guess_dict_unit;
+	phase->keyspace = 0;
+	run_phase(pool, phase, units > 0 ? units : 1);
+}
+
+// dictionary units are small enough to just be redone when resuming
+void guess_dict_unit(Phase *phase, long unit, int worker, const int *resume) {
+	Word *word = &phase->words[worker];
+	Dict *dict = phase->dict;
+
+	long end = (unit + 1) * DICT_UNIT;
+	end = end < dict->count ? end : dict->count;
+
+	for (long i = unit * DICT_UNIT; i < end && pipeline_more(phase->pipe); i++) {
+		int len;
+		const char *line = dict_word(dict, i, &len);
+		// guesses never look past the first LEN_PWD_MAX characters
+		memcpy(word->word, line, len < LEN_PWD_MAX ? len : LEN_PWD_MAX);
+		phase->guess_word(phase, word, line, len);
+	}
+}
+
+void run_mask_phase(Pool *pool, Phase *phase) {
+	Mask *mask = phase->mask;
+	if (phase_skip(phase, mask->len)) {
+		return;
+	}
+
+	long units = 1;
+	for (int i = 0; i < phase->mask_unit_len && i < mask->len - 1; i++) {
+		units *= mask->radix[i];
+	}
+	phase->guess_unit = guess_mask_unit;
+	phase->keyspace = mask_keyspace(mask);
+	run_phase(pool, phase, units);
+}
+
+void guess_mask_unit(Phase *phase, long unit, int worker, const int *resume) {
+	Word *word = &phase->words[worker];
+	Mask *mask = phase->mask;
+	int len = mask->len, last = len - 1;
+
+	// the unit picks the first few characters, always leaving the last
+	int fixed = phase->mask_unit_len < last ? phase->mask_unit_len : last;
+	for (int i = fixed - 1; i >= 0; i--) {
+		word->index[i] = unit % mask->radix[i];
+		word->word[i] = mask->set[i][word->index[i]];
+		unit /= mask->radix[i];
+	}
+
+	// the rest start from where the last run got to in this unit, if anywhere
+	for (int i = fixed; i < len; i++) {
+		word->index[i] = resume ? resume[i] : 0;
+		word->word[i] = mask->set[i][word->index[i]];
+	}
+
+	// shorter masks carry through fewer positions before progress is noted
+	int checkpoint_pos = CHECKPOINT_POS - (LEN_PWD_MAX - len);
+
+	const char *inner = mask->set[last];
+	int inner_radix = mask->radix[last];
+	for (;;) {
+		// the last position runs straight through its set
+		for (int c = word->index[last]; c < inner_radix && pipeline_more(phase->pipe); c++) {
+			word->word[last] = inner[c];
+			make_guess(word, len, phase->pipe);
+		}
+		if (!pipeline_more(phase->pipe)) {
+			break;
+		}
+		word->index[last] = 0;
+
+		// then carries into the next position along that has not wrapped
+		int i = mask_carry(mask, word->word, word->index, fixed);
+		if (i < 0) {
+			break;
+		}
+
+		if (phase->checkpoint && i <= checkpoint_pos) {
+			// guesses before the odometer are all on their way to being checked
+			word_flush(word, phase->pipe);
+			checkpoint_progress(phase->checkpoint, worker, word->index);
+		}
+	}
+}
+
+// a worker's word and where its guesses go, for generators calling back
+typedef struct {
+	Word *word;
+	Pipeline *pipe;
+} Guesser;
+
+static int rule_guess(void *arg, const char *guess, int len) {
+	Guesser *guesser = arg;
+
+	// nothing longer could be a password
+	if (len > 0 && len <= LEN_PWD_MAX) {
+		memcpy(guesser->word->word, guess, len);
+		make_guess(guesser->word, len, guesser->pipe);
+	}
+
+	return pipeline_more(guesser->pipe);
+}
+
+void guess_rules(Phase *phase, Word *word, const char *line, int len) {
+	Guesser guesser = { word, phase->pipe };
+	rules_apply(phase->rules, line, len, rule_guess, &guesser);
+}
+
+// a markov unit's guesses, noting progress as the walk moves along
+typedef struct {
+	Word *word;
+	Phase *phase;
+	int worker;
+	// progress is noted whenever the walk moves at pos or before it
+	int pos;
+	int last[LEN_PWD_MAX];
+} MarkovGuesser;
+
+// markov builds its guesses in the word already, and where it is in index
+static int markov_guess(void *arg, const char *guess, int len) {
+	MarkovGuesser *guesser = arg;
+	Word *word = guesser->word;
+	Phase *phase = guesser->phase;
+
+	if (phase->checkpoint && memcmp(guesser->last, word->index, sizeof(int) * (guesser->pos + 1))) {
+		// guesses before this one are all on their way to being checked
+		word_flush(word, phase->pipe);
+		checkpoint_progress(phase->checkpoint, guesser->worker, word->index);
+		memcpy(guesser->last, word->index, sizeof(int) * (guesser->pos + 1));
+	}
+
+	make_guess(word, len, phase->pipe);
+	return pipeline_more(phase->pipe);
+}
+
+void run_markov_phase(Pool *pool, Phase *phase) {
+	if (phase_skip(phase, phase->markov->len)) {
+		return;
+	}
+
+	// a unit for each first character
+	phase->guess_unit = guess_markov_unit;
+	snprintf(phase->name, STATS_NAME_MAX, "markov level %d", phase->level);
+	phase->keyspace = 0;
+	run_phase(pool, phase, MARKOV_CHARS);
+}
+
+void guess_markov_unit(Phase *phase, long unit, int worker, const int *resume) {
+	Word *word = &phase->words[worker];
+	int len = phase->markov->len;
+
+	// as often as a mask of the same length notes its progress
+	MarkovGuesser guesser = { word, phase, worker, CHECKPOINT_POS - (LEN_PWD_MAX - len) };
+	for (int i = 0; i < LEN_PWD_MAX; i++) {
+		guesser.last[i] = resume ? resume[i] : -1;
+	}
+
+	markov_level(phase->markov, phase->level, unit, resume, word->word, word->index, markov_guess, &guesser);
+}
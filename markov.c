@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "markov.h"
+
+#define LINE_MAX_LEN 256
+
+// how much an unseen previous character leans on the position's own counts
+#define MARKOV_BACKOFF 4.0
+
+static int markov_walk(const Markov *markov, int pos, int prev, int budget, const int *resume, char *word,
+                       int *index, MarkovEmit emit, void *arg);
+static int markov_compare(const void *a, const void *b);
+
+// a character and how likely it is, for sorting
+typedef struct {
+	double p;
+	int c;
+} MarkovChar;
+
+int markov_train(Markov *markov, const char *filename, int len) {
+	assert(len > 0 && len <= MARKOV_LEN_MAX);
+
+	FILE *fp = fopen(filename, "r");
+	if (!fp) {
+		return -1;
+	}
+
+	// counts of each character after each previous one, and at all, by position
+	int (*pairs)[MARKOV_CHARS + 1][MARKOV_CHARS] = calloc(len, sizeof(*pairs));
+	int (*singles)[MARKOV_CHARS] = calloc(len, sizeof(*singles));
+	assert(pairs && singles);
+
+	char line[LINE_MAX_LEN];
+	while (fgets(line, LINE_MAX_LEN, fp)) {
+		int prev = MARKOV_START;
+		for (int i = 0; i < len; i++) {
+			int c = (unsigned char) line[i] - MARKOV_CHAR_MIN;
+			// stops at the newline, or anything unprintable
+			if (c < 0 || c >= MARKOV_CHARS) {
+				break;
+			}
+			pairs[i][prev][c]++;
+			singles[i][c]++;
+			prev = c;
+		}
+	}
+	fclose(fp);
+
+	markov->len = len;
+	for (int i = 0; i < len; i++) {
+		int single_total = 0;
+		for (int c = 0; c < MARKOV_CHARS; c++) {
+			single_total += singles[i][c];
+		}
+
+		for (int prev = 0; prev <= MARKOV_CHARS; prev++) {
+			int pair_total = 0;
+			for (int c = 0; c < MARKOV_CHARS; c++) {
+				pair_total += pairs[i][prev][c];
+			}
+
+			// smoothed so every character is possible, falling back on the
+			// position's counts where the previous character was rarely seen
+			MarkovChar chars[MARKOV_CHARS];
+			for (int c = 0; c < MARKOV_CHARS; c++) {
+				double single = (singles[i][c] + 1.0) / (single_total + MARKOV_CHARS);
+				chars[c].p = (pairs[i][prev][c] + MARKOV_BACKOFF * single) / (pair_total + MARKOV_BACKOFF);
+				chars[c].c = c;
+			}
+			qsort(chars, MARKOV_CHARS, sizeof(MarkovChar), markov_compare);
+
+			// a level for each halving of probability
+			unsigned char *start = markov->start[i][prev];
+			memset(start, 0, MARKOV_LEVELS + 1);
+			for (int k = 0; k < MARKOV_CHARS; k++) {
+				int level = 0;
+				for (double p = chars[k].p; p < 0.5 && level < MARKOV_LEVELS - 1; p *= 2) {
+					level++;
+				}
+				markov->order[i][prev][k] = chars[k].c;
+				start[level + 1]++;
+			}
+			for (int l = 0; l < MARKOV_LEVELS; l++) {
+				start[l + 1] += start[l];
+			}
+		}
+	}
+
+	free(pairs);
+	free(singles);
+
+	// the bounds on what is left of a word, from the end back
+	for (int prev = 0; prev <= MARKOV_CHARS; prev++) {
+		markov->least[len][prev] = 0;
+		markov->most[len][prev] = 0;
+	}
+	for (int i = len - 1; i >= 0; i--) {
+		for (int prev = 0; prev <= MARKOV_CHARS; prev++) {
+			int least = -1, most = -1;
+			const unsigned char *start = markov->start[i][prev];
+			for (int l = 0; l < MARKOV_LEVELS; l++) {
+				for (int k = start[l]; k < start[l + 1]; k++) {
+					int c = markov->order[i][prev][k];
+					int lo = l + markov->least[i + 1][c], hi = l + markov->most[i + 1][c];
+					least = least < 0 || lo < least ? lo : least;
+					most = hi > most ? hi : most;
+				}
+			}
+			markov->least[i][prev] = least;
+			markov->most[i][prev] = most;
+		}
+	}
+
+	return 0;
+}
+
+int markov_least(const Markov *markov) {
+	return markov->least[0][MARKOV_START];
+}
+
+int markov_most(const Markov *markov) {
+	return markov->most[0][MARKOV_START];
+}
+
+int markov_level(const Markov *markov, int level, int first, const int *resume, char *word, int *index,
+                 MarkovEmit emit, void *arg) {
+	const unsigned char *start = markov->start[0][MARKOV_START];
+	int l = 0;
+	while (start[l + 1] <= first) {
+		l++;
+	}
+
+	int c = markov->order[0][MARKOV_START][first];
+	int budget = level - l;
+	if (budget < markov->least[1][c] || budget > markov->most[1][c]) {
+		return 1;
+	}
+
+	word[0] = MARKOV_CHAR_MIN + c;
+	index[0] = first;
+	if (markov->len == 1) {
+		return emit(arg, word, 1);
+	}
+	return markov_walk(markov, 1, c, budget, resume, word, index, emit, arg);
+}
+
+// fills in word from pos on, with characters adding up to budget levels,
+// starting from resume's rank at pos if there is one
+static int markov_walk(const Markov *markov, int pos, int prev, int budget, const int *resume, char *word,
+                       int *index, MarkovEmit emit, void *arg) {
+	const unsigned char *order = markov->order[pos][prev];
+	const unsigned char *start = markov->start[pos][prev];
+	int last = pos == markov->len - 1;
+
+	// ranks run through the levels in order, so a resumed rank skips the
+	// levels before its own
+	int k = resume ? resume[pos] : 0;
+	for (int l = 0; l < MARKOV_LEVELS && l <= budget; l++) {
+		for (k = k > start[l] ? k : start[l]; k < start[l + 1]; k++) {
+			int c = order[k];
+			// only characters that leave a budget the rest can use up exactly
+			int rest = budget - l;
+			if (rest < markov->least[pos + 1][c] || rest > markov->most[pos + 1][c]) {
+				continue;
+			}
+
+			word[pos] = MARKOV_CHAR_MIN + c;
+			index[pos] = k;
+			if (last) {
+				if (!emit(arg, word, markov->len)) {
+					return 0;
+				}
+			} else if (!markov_walk(markov, pos + 1, c, rest, resume, word, index, emit, arg)) {
+				return 0;
+			}
+			// only the first word walked to is where the resumed walk was
+			resume = NULL;
+		}
+	}
+
+	return 1;
+}
+
+// most likely first, then in character order
+static int markov_compare(const void *a, const void *b) {
+	const MarkovChar *x = a, *y = b;
+	if (x->p != y->p) {
+		return x->p < y->p ? 1 : -1;
+	}
+	return x->c - y->c;
+}
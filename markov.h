@@ -0,0 +1,49 @@
+#ifndef MARKOV_H
+#define MARKOV_H
+
+// orders the printable keyspace by how likely each character is given its
+// position and the one before it, as trained from a list of passwords.
+// probabilities are bucketed into levels, 0 the most likely, and words are
+// enumerated a total level at a time so every word turns up exactly once
+
+#define MARKOV_LEN_MAX  8
+#define MARKOV_LEVELS  16
+// printable characters, plus one standing for the start of the word
+#define MARKOV_CHAR_MIN 32
+#define MARKOV_CHARS    95
+#define MARKOV_START    MARKOV_CHARS
+
+typedef struct {
+	int len;
+
+	// for each position and previous character, the characters in order of
+	// level, and where each level's run of them starts
+	unsigned char order[MARKOV_LEN_MAX][MARKOV_CHARS + 1][MARKOV_CHARS];
+	unsigned char start[MARKOV_LEN_MAX][MARKOV_CHARS + 1][MARKOV_LEVELS + 1];
+
+	// the least and most total level the rest of a word from each position
+	// can add, given the previous character
+	short least[MARKOV_LEN_MAX + 1][MARKOV_CHARS + 1];
+	short most[MARKOV_LEN_MAX + 1][MARKOV_CHARS + 1];
+} Markov;
+
+// takes a word, returning 0 to stop
+typedef int (*MarkovEmit)(void *arg, const char *word, int len);
+
+// trains a model of len character words from filename, one password a
+// line. returns -1 if it could not be read
+int markov_train(Markov *markov, const char *filename, int len);
+
+// the range of total levels words can have
+int markov_least(const Markov *markov);
+int markov_most(const Markov *markov);
+
+// emits, built in word, every word of the given total level starting with
+// the first'th most likely first character (of MARKOV_CHARS). index holds
+// where the walk is, the rank of each position's character, as each word is
+// emitted, and a walk given one as resume picks up at that word. returns 0
+// if emit asked to stop
+int markov_level(const Markov *markov, int level, int first, const int *resume, char *word, int *index,
+                 MarkovEmit emit, void *arg);
+
+#endif
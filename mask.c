@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mask.h"
+
+static int mask_expand(char *set, const char *source, int len, char *custom[MASK_CUSTOM], int nested);
+static int mask_builtin(char c, char *custom[MASK_CUSTOM], int nested, const char **set, int *set_len);
+
+static const char *lower   = "abcdefghijklmnopqrstuvwxyz";
+static const char *upper   = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char *digits  = "0123456789";
+static const char *special = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+static const char *all     = " !\"#$%&'()*+,-./0123456789:;<=>?" \
+                             "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_" \
+                             "`abcdefghijklmnopqrstuvwxyz{|}~";
+
+int mask_compile(Mask *mask, const char *source, char *custom[MASK_CUSTOM]) {
+	mask->len = 0;
+
+	for (const char *p = source; *p; p++) {
+		if (mask->len >= MASK_LEN_MAX) {
+			return -1;
+		}
+
+		int radix;
+		if (*p == '?') {
+			if (!*++p) {
+				return -1;
+			}
+			const char *set;
+			int set_len;
+			if (!mask_builtin(*p, custom, 0, &set, &set_len)) {
+				return -1;
+			}
+			// only custom sets can have other sets inside them
+			int is_custom = '1' <= *p && *p < '1' + MASK_CUSTOM;
+			radix = mask_expand(mask->set[mask->len], set, set_len, custom, is_custom);
+		} else {
+			mask->set[mask->len][0] = *p;
+			radix = 1;
+		}
+
+		if (radix <= 0) {
+			return -1;
+		}
+		mask->radix[mask->len++] = radix;
+	}
+
+	return mask->len > 0 ? 0 : -1;
+}
+
+unsigned long long mask_keyspace(const Mask *mask) {
+	unsigned long long keyspace = 1;
+	for (int i = 0; i < mask->len; i++) {
+		if (keyspace > ~0ULL / mask->radix[i]) {
+			return 0;
+		}
+		keyspace *= mask->radix[i];
+	}
+	return keyspace;
+}
+
+// the odometer over one set the set phases run, from offset up to max
+int next_set(char *word, int *index, int offset, int max, const char *set, int set_len) {
+	// increment the part of the word after offset to be the next in the set
+	for (int i = max - 1; i >= offset; i--) {
+		int next = (index[i] + 1) % set_len;
+		index[i] = next;
+		word[i] = set[next];
+
+		// next == 0 => we the next character can be incremented
+		if (next != 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// the carry of the mask odometer guess_mask_unit runs
+int mask_carry(const Mask *mask, char *word, int *index, int fixed) {
+	int i = mask->len - 2;
+	for (; i >= fixed && ++index[i] == mask->radix[i]; i--) {
+		index[i] = 0;
+		word[i] = mask->set[i][0];
+	}
+	if (i < fixed) {
+		return -1;
+	}
+	word[i] = mask->set[i][index[i]];
+	return i;
+}
+
+// writes the characters of source into set, dropping repeats and, if it is
+// nested in a custom set, expanding any ?x. returns how many there are, or
+// -1 if it is malformed
+static int mask_expand(char *set, const char *source, int len, char *custom[MASK_CUSTOM], int nested) {
+	char seen[256] = {0};
+	int n = 0;
+
+	for (int i = 0; i < len; i++) {
+		const char *part = &source[i];
+		int part_len = 1;
+		// a custom set can be built from the others
+		if (nested && source[i] == '?') {
+			if (++i >= len || !mask_builtin(source[i], custom, 1, &part, &part_len)) {
+				return -1;
+			}
+		}
+
+		for (int j = 0; j < part_len; j++) {
+			unsigned char c = part[j];
+			if (!seen[c]) {
+				seen[c] = 1;
+				set[n++] = c;
+			}
+		}
+	}
+
+	return n;
+}
+
+// looks up the set ?c stands for. custom sets only when not already in one
+static int mask_builtin(char c, char *custom[MASK_CUSTOM], int nested, const char **set, int *set_len) {
+	switch (c) {
+	case 'l':
+		*set = lower;
+		break;
+	case 'u':
+		*set = upper;
+		break;
+	case 'd':
+		*set = digits;
+		break;
+	case 's':
+		*set = special;
+		break;
+	case 'a':
+		*set = all;
+		break;
+	case '?':
+		*set = "?";
+		break;
+	default:
+		if (nested || c < '1' || c >= '1' + MASK_CUSTOM || !custom || !custom[c - '1']) {
+			return 0;
+		}
+		*set = custom[c - '1'];
+	}
+
+	*set_len = strlen(*set);
+	return 1;
+}
@@ -0,0 +1,36 @@
+#ifndef MASK_H
+#define MASK_H
+
+// a mask gives each position of a guess its own character set, e.g.
+// ?u?l?l?l?d?d. ?l, ?u, ?d and ?s are lowercase, uppercase, digits and
+// specials, ?a is every printable character, ?1 to ?4 are the custom sets,
+// ?? is a literal ?, and any other character stands for itself
+
+#define MASK_LEN_MAX 16
+#define MASK_CUSTOM   4
+
+typedef struct {
+	int len;
+	// each position's characters, in the order they are tried, and how many
+	char set[MASK_LEN_MAX][256];
+	int radix[MASK_LEN_MAX];
+} Mask;
+
+// compiles source against up to MASK_CUSTOM custom sets (NULL if unset, or
+// custom NULL for none), which may themselves use the built in sets.
+// returns 0, or -1 if source is malformed, too long, or uses an unset
+// custom set
+int mask_compile(Mask *mask, const char *source, char *custom[MASK_CUSTOM]);
+// the number of guesses the mask makes, or 0 if that overflows
+unsigned long long mask_keyspace(const Mask *mask);
+
+// mutates word, and the index in set of each of its characters, to be the
+// next word in the set from offset to max. returns the leftmost position
+// that changed, or -1 once every one has wrapped round
+int next_set(char *word, int *index, int offset, int max, const char *set, int set_len);
+// carries a mask's odometer along, once its last position has run through
+// its set, into the next position that does not wrap. positions before
+// fixed never move. returns the position that moved, or -1 if none could
+int mask_carry(const Mask *mask, char *word, int *index, int fixed);
+
+#endif
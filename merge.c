@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFF_SIZE 1024
+#define GROWTH_FACTOR 2
+
+// a cracked password and the (1 based) index of the hash it matched, and
+// the file of hashes if the run had more than one
+typedef struct {
+	char *word;
+	long index;
+	char *file;
+} Found;
+
+int read_found(char *filename, Found **found, int *count, int *alloc);
+int compare_found(const void *a, const void *b);
+void check_error(void *ptr, char *str);
+
+// merges the hits printed by several `crack --shard k/n` runs into the
+// found_pwds.txt format: one "<word> <index>" per line, in order of index.
+// hits from runs over several hash files keep their "<file>" after the
+// index, and are grouped by it
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "USAGE: <program> <found_file : string> ...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int count = 0, alloc = 16;
+	Found *found = malloc(sizeof(Found) * alloc);
+	check_error(found, "malloc");
+
+	for (int i = 1; i < argc; i++) {
+		if (!read_found(argv[i], &found, &count, &alloc)) {
+			perror(argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	qsort(found, count, sizeof(Found), compare_found);
+
+	// a hash may have been cracked by more than one shard
+	for (int i = 0; i < count; i++) {
+		if (i == 0 || compare_found(&found[i], &found[i - 1])) {
+			if (*found[i].file) {
+				printf("%s %ld %s\n", found[i].word, found[i].index, found[i].file);
+			} else {
+				printf("%s %ld\n", found[i].word, found[i].index);
+			}
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		free(found[i].word);
+		free(found[i].file);
+	}
+
+	free(found);
+
+	exit(EXIT_SUCCESS);
+}
+
+int read_found(char *filename, Found **found, int *count, int *alloc) {
+	FILE *fp = fopen(filename, "r");
+	if (!fp) {
+		return 0;
+	}
+
+	char line[BUFF_SIZE];
+	while (fgets(line, BUFF_SIZE, fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		// passwords can contain spaces, so the index is after the last one,
+		// unless that is the name of the hash file
+		char *space = strrchr(line, ' '), *file = "";
+		if (!space) {
+			continue;
+		}
+		char *end;
+		long index = strtol(space + 1, &end, 10);
+		if (*end != '\0' || end == space + 1) {
+			file = space + 1;
+			*space = '\0';
+			space = strrchr(line, ' ');
+			if (!space) {
+				continue;
+			}
+			index = strtol(space + 1, &end, 10);
+			if (*end != '\0' || end == space + 1) {
+				continue;
+			}
+		}
+		if (index <= 0) {
+			continue;
+		}
+		*space = '\0';
+
+		if (*count >= *alloc) {
+			*alloc *= GROWTH_FACTOR;
+			*found = realloc(*found, sizeof(Found) * *alloc);
+			check_error(*found, "realloc");
+		}
+
+		Found *f = &(*found)[(*count)++];
+		f->word = malloc(strlen(line) + 1);
+		check_error(f->word, "malloc");
+		strcpy(f->word, line);
+		f->index = index;
+		f->file = malloc(strlen(file) + 1);
+		check_error(f->file, "malloc");
+		strcpy(f->file, file);
+	}
+
+	fclose(fp);
+
+	return 1;
+}
+
+int compare_found(const void *a, const void *b) {
+	const Found *x = a, *y = b;
+	int file = strcmp(x->file, y->file);
+	if (file) {
+		return file;
+	}
+	return (x->index > y->index) - (x->index < y->index);
+}
+
+void check_error(void *ptr, char *str) {
+	if (!ptr) {
+		perror(str);
+		exit(EXIT_FAILURE);
+	}
+}
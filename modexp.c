@@ -0,0 +1,314 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "modexp.h"
+
+// double width products, which gcc and clang have on 64 bit targets
+__extension__ typedef unsigned __int128 Wide;
+
+// largest power of 10 in a limb, for writing numbers out a limb at a time
+#define DECIMAL_CHUNK        10000000000000000000ULL
+#define DECIMAL_CHUNK_DIGITS 19
+
+static void mont_mul(const Modexp *mod, Limb *out, const Limb *a, const Limb *b);
+static void mont_from(const Modexp *mod, Limb *out, const Limb *a);
+static int compare(const Limb *a, const Limb *b, int limbs);
+static Limb subtract(Limb *a, const Limb *b, int limbs);
+static int bit_length(const Limb *x, int limbs);
+static int parse(Limb *out, int limbs, const char *str);
+
+int modexp_init(Modexp *mod, const Limb *n, int limbs) {
+	if (limbs < 1 || limbs > MODEXP_LIMBS_MAX || !(n[0] & 1) || bit_length(n, limbs) < 2) {
+		return -1;
+	}
+
+	mod->limbs = limbs;
+	memcpy(mod->n, n, sizeof(Limb) * limbs);
+
+	// newton's iteration doubles the correct low bits of the inverse each
+	// step, and an odd n is its own inverse to 3 bits
+	Limb inv = n[0];
+	for (int i = 0; i < 5; i++) {
+		inv *= 2 - n[0] * inv;
+	}
+	mod->n0 = -inv;
+
+	// R then R^2 mod n, by doubling 1 a bit at a time
+	Limb x[MODEXP_LIMBS_MAX] = { 1 };
+	for (int i = 0; i < 2 * 64 * limbs; i++) {
+		Limb carry = x[limbs - 1] >> 63;
+		for (int j = limbs - 1; j > 0; j--) {
+			x[j] = x[j] << 1 | x[j - 1] >> 63;
+		}
+		x[0] <<= 1;
+		if (carry || compare(x, n, limbs) >= 0) {
+			subtract(x, n, limbs);
+		}
+		if (i == 64 * limbs - 1) {
+			memcpy(mod->one, x, sizeof(Limb) * limbs);
+		}
+	}
+	memcpy(mod->r2, x, sizeof(Limb) * limbs);
+
+	return 0;
+}
+
+void modexp_pow(const Modexp *mod, Limb *out, const Limb *base, const Limb *exp, int exp_limbs) {
+	int limbs = mod->limbs;
+
+	// base to the power of every digit a window can have
+	Limb powers[1 << MODEXP_WINDOW][MODEXP_LIMBS_MAX];
+	memcpy(powers[0], mod->one, sizeof(Limb) * limbs);
+	mont_mul(mod, powers[1], base, mod->r2);
+	for (int d = 2; d < 1 << MODEXP_WINDOW; d++) {
+		mont_mul(mod, powers[d], powers[d - 1], powers[1]);
+	}
+
+	// a window of the exponent at a time from the top, squaring the rest up
+	Limb acc[MODEXP_LIMBS_MAX];
+	memcpy(acc, mod->one, sizeof(Limb) * limbs);
+	int bits = bit_length(exp, exp_limbs), started = 0;
+	for (int at = (bits + MODEXP_WINDOW - 1) / MODEXP_WINDOW * MODEXP_WINDOW; at > 0;) {
+		at -= MODEXP_WINDOW;
+		if (started) {
+			for (int i = 0; i < MODEXP_WINDOW; i++) {
+				mont_mul(mod, acc, acc, acc);
+			}
+		}
+		int digit = exp[at / 64] >> (at % 64) & ((1 << MODEXP_WINDOW) - 1);
+		if (digit) {
+			mont_mul(mod, acc, acc, powers[digit]);
+			started = 1;
+		}
+	}
+
+	mont_from(mod, out, acc);
+}
+
+void modexp_fixed_init(FixedBase *fixed, const Modexp *mod, const Limb *g, int bits) {
+	int limbs = mod->limbs, digits = 1 << MODEXP_WINDOW;
+
+	fixed->mod = mod;
+	fixed->windows = (bits + MODEXP_WINDOW - 1) / MODEXP_WINDOW;
+	fixed->bits = fixed->windows * MODEXP_WINDOW;
+	memcpy(fixed->g, g, sizeof(Limb) * limbs);
+
+	fixed->table = malloc(sizeof(Limb) * limbs * digits * (fixed->windows > 0 ? fixed->windows : 1));
+	assert(fixed->table);
+
+	// g^(2^(jw)) for the window being filled in
+	Limb step[MODEXP_LIMBS_MAX];
+	mont_mul(mod, step, g, mod->r2);
+	for (int j = 0; j < fixed->windows; j++) {
+		Limb *window = &fixed->table[(size_t) j * digits * limbs];
+		memcpy(window, mod->one, sizeof(Limb) * limbs);
+		for (int d = 1; d < digits; d++) {
+			mont_mul(mod, &window[d * limbs], &window[(d - 1) * limbs], step);
+		}
+		mont_mul(mod, step, &window[(digits - 1) * limbs], step);
+	}
+}
+
+void modexp_fixed_free(FixedBase *fixed) {
+	free(fixed->table);
+}
+
+void modexp_fixed_pow(const FixedBase *fixed, Limb *out, const Limb *exp, int exp_limbs) {
+	const Modexp *mod = fixed->mod;
+	int limbs = mod->limbs, digits = 1 << MODEXP_WINDOW;
+
+	if (bit_length(exp, exp_limbs) > fixed->bits) {
+		modexp_pow(mod, out, fixed->g, exp, exp_limbs);
+		return;
+	}
+
+	// no squaring at all, just a multiply for each window that is not 0
+	Limb acc[MODEXP_LIMBS_MAX];
+	int started = 0;
+	for (int j = 0; j < fixed->windows; j++) {
+		int at = j * MODEXP_WINDOW;
+		int digit = at / 64 < exp_limbs ? exp[at / 64] >> (at % 64) & (digits - 1) : 0;
+		if (!digit) {
+			continue;
+		}
+		const Limb *power = &fixed->table[((size_t) j * digits + digit) * limbs];
+		if (started) {
+			mont_mul(mod, acc, acc, power);
+		} else {
+			memcpy(acc, power, sizeof(Limb) * limbs);
+			started = 1;
+		}
+	}
+	if (!started) {
+		memcpy(acc, mod->one, sizeof(Limb) * limbs);
+	}
+
+	mont_from(mod, out, acc);
+}
+
+void modexp_fixed_batch(const FixedBase *fixed, Limb *out, const Limb *exps, int exp_limbs, int n_exps) {
+	int limbs = fixed->mod->limbs;
+	for (int i = 0; i < n_exps; i++) {
+		modexp_fixed_pow(fixed, &out[(size_t) i * limbs], &exps[(size_t) i * exp_limbs], exp_limbs);
+	}
+}
+
+int modexp_parse(Limb *out, int limbs, const char *str) {
+	return parse(out, limbs, str);
+}
+
+int modexp_limbs(const char *str) {
+	Limb x[MODEXP_LIMBS_MAX];
+	if (parse(x, MODEXP_LIMBS_MAX, str) < 0) {
+		return -1;
+	}
+	int bits = bit_length(x, MODEXP_LIMBS_MAX);
+	return bits > 0 ? (bits + 63) / 64 : 1;
+}
+
+int modexp_format(char *buf, size_t size, const Limb *x, int limbs) {
+	Limb left[MODEXP_LIMBS_MAX], chunks[(MODEXP_LIMBS_MAX * 64 + 62) / 63];
+	memcpy(left, x, sizeof(Limb) * limbs);
+
+	// DECIMAL_CHUNK_DIGITS digits at a time, least significant first
+	int n_chunks = 0;
+	do {
+		Limb rem = 0;
+		for (int i = limbs - 1; i >= 0; i--) {
+			Wide part = (Wide) rem << 64 | left[i];
+			left[i] = part / DECIMAL_CHUNK;
+			rem = part % DECIMAL_CHUNK;
+		}
+		chunks[n_chunks++] = rem;
+	} while (bit_length(left, limbs) > 0);
+
+	size_t len = snprintf(buf, size, "%llu", (unsigned long long) chunks[--n_chunks]);
+	while (len < size && n_chunks > 0) {
+		len += snprintf(buf + len, size - len, "%0*llu", DECIMAL_CHUNK_DIGITS,
+		                (unsigned long long) chunks[--n_chunks]);
+	}
+
+	return len < size ? 0 : -1;
+}
+
+// out = a * b / R mod n, for a below R and b below n. out may be either
+static void mont_mul(const Modexp *mod, Limb *out, const Limb *a, const Limb *b) {
+	int limbs = mod->limbs;
+
+	if (limbs == 1) {
+		Wide t = (Wide) a[0] * b[0];
+		Limb lo = t, q = lo * mod->n0;
+		// lo + the low half of q * n is 0 mod 2^64, carrying unless lo is
+		Wide u = (t >> 64) + (((Wide) q * mod->n[0]) >> 64) + (lo != 0);
+		out[0] = u >= mod->n[0] ? (Limb) (u - mod->n[0]) : (Limb) u;
+		return;
+	}
+
+	// coarsely integrated operand scanning: a limb of b at a time, adding
+	// a * b[i] then enough of n to shift a limb off
+	Limb t[MODEXP_LIMBS_MAX + 2] = { 0 };
+	for (int i = 0; i < limbs; i++) {
+		Limb carry = 0;
+		for (int j = 0; j < limbs; j++) {
+			Wide s = (Wide) a[j] * b[i] + t[j] + carry;
+			t[j] = s;
+			carry = s >> 64;
+		}
+		Wide s = (Wide) t[limbs] + carry;
+		t[limbs] = s;
+		t[limbs + 1] = s >> 64;
+
+		Limb q = t[0] * mod->n0;
+		s = (Wide) q * mod->n[0] + t[0];
+		carry = s >> 64;
+		for (int j = 1; j < limbs; j++) {
+			s = (Wide) q * mod->n[j] + t[j] + carry;
+			t[j - 1] = s;
+			carry = s >> 64;
+		}
+		s = (Wide) t[limbs] + carry;
+		t[limbs - 1] = s;
+		t[limbs] = t[limbs + 1] + (Limb) (s >> 64);
+	}
+
+	if (t[limbs] || compare(t, mod->n, limbs) >= 0) {
+		subtract(t, mod->n, limbs);
+	}
+	memcpy(out, t, sizeof(Limb) * limbs);
+}
+
+// takes a out of montgomery form
+static void mont_from(const Modexp *mod, Limb *out, const Limb *a) {
+	Limb unit[MODEXP_LIMBS_MAX] = { 1 };
+	mont_mul(mod, out, a, unit);
+}
+
+static int compare(const Limb *a, const Limb *b, int limbs) {
+	for (int i = limbs - 1; i >= 0; i--) {
+		if (a[i] != b[i]) {
+			return a[i] > b[i] ? 1 : -1;
+		}
+	}
+	return 0;
+}
+
+// a -= b, returning the borrow out of the top
+static Limb subtract(Limb *a, const Limb *b, int limbs) {
+	Limb borrow = 0;
+	for (int i = 0; i < limbs; i++) {
+		Limb d = a[i] - b[i] - borrow;
+		borrow = (a[i] < b[i]) || (a[i] == b[i] && borrow);
+		a[i] = d;
+	}
+	return borrow;
+}
+
+static int bit_length(const Limb *x, int limbs) {
+	for (int i = limbs - 1; i >= 0; i--) {
+		if (x[i]) {
+			return i * 64 + 64 - __builtin_clzll(x[i]);
+		}
+	}
+	return 0;
+}
+
+static int parse(Limb *out, int limbs, const char *str) {
+	int base = 10;
+	if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+		base = 16;
+		str += 2;
+	}
+	if (!*str) {
+		return -1;
+	}
+
+	memset(out, 0, sizeof(Limb) * limbs);
+	for (; *str; str++) {
+		int digit;
+		if ('0' <= *str && *str <= '9') {
+			digit = *str - '0';
+		} else if (base == 16 && 'a' <= (*str | 0x20) && (*str | 0x20) <= 'f') {
+			digit = (*str | 0x20) - 'a' + 10;
+		} else {
+			return -1;
+		}
+		if (digit >= base) {
+			return -1;
+		}
+
+		// out = out * base + digit, which must not carry off the top
+		Limb carry = digit;
+		for (int i = 0; i < limbs; i++) {
+			Wide s = (Wide) out[i] * base + carry;
+			out[i] = s;
+			carry = s >> 64;
+		}
+		if (carry) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef MODEXP_H
+#define MODEXP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// modular exponentiation for diffie hellman. numbers are arrays of 64 bit
+// limbs, least significant first, as long as the modulus. a one limb modulus
+// takes a 128 bit product path, longer ones multi limb montgomery
+
+// longest modulus, in limbs (2048 bits)
+#define MODEXP_LIMBS_MAX 32
+// bits of exponent each fixed base table lookup covers
+#define MODEXP_WINDOW     4
+
+typedef uint64_t Limb;
+
+typedef struct {
+	int limbs;
+	Limb n[MODEXP_LIMBS_MAX];
+	// -1/n mod 2^64, and R and R^2 mod n for R = 2^(64 * limbs)
+	Limb n0;
+	Limb one[MODEXP_LIMBS_MAX];
+	Limb r2[MODEXP_LIMBS_MAX];
+} Modexp;
+
+// powers of a fixed base g: window j of the table holds g^(d * 2^(jw)) for
+// each digit d of MODEXP_WINDOW bits, so g^e is one multiply a window of e
+typedef struct {
+	const Modexp *mod;
+	int bits, windows;
+	Limb g[MODEXP_LIMBS_MAX];
+	Limb *table;
+} FixedBase;
+
+// sets up arithmetic mod n, limbs long. returns -1 if n is even, less than
+// 3, or too long
+int modexp_init(Modexp *mod, const Limb *n, int limbs);
+
+// out = base ^ exp mod n, for an exponent exp_limbs long. out may be base
+void modexp_pow(const Modexp *mod, Limb *out, const Limb *base, const Limb *exp, int exp_limbs);
+
+// precomputes the powers of g for exponents of up to bits bits
+void modexp_fixed_init(FixedBase *fixed, const Modexp *mod, const Limb *g, int bits);
+void modexp_fixed_free(FixedBase *fixed);
+// out = g ^ exp mod n. longer exponents than the table was made for take the
+// usual path
+void modexp_fixed_pow(const FixedBase *fixed, Limb *out, const Limb *exp, int exp_limbs);
+// out[i] = g ^ exps[i] mod n for n_exps exponents, each exp_limbs long, one
+// after the other in exps. results are the modulus's limbs apart in out
+void modexp_fixed_batch(const FixedBase *fixed, Limb *out, const Limb *exps, int exp_limbs, int n_exps);
+
+// reads a decimal, or 0x prefixed hex, number into limbs limbs. returns -1
+// if it is malformed or does not fit
+int modexp_parse(Limb *out, int limbs, const char *str);
+// how many limbs the number in str needs, at least 1, or -1 if it is
+// malformed or longer than MODEXP_LIMBS_MAX
+int modexp_limbs(const char *str);
+// writes x, limbs long, out in decimal. returns -1 if size is too small
+int modexp_format(char *buf, size_t size, const Limb *x, int limbs);
+
+#endif
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+
+static void *pipeline_thread(void *arg);
+static void pipeline_done(Pipeline *pipe, Batch *batch);
+
+void pipeline_init(Pipeline *pipe, int producers, int consumers, long limit, Sink sink, void *arg) {
+	pipe->sink = sink;
+	pipe->arg = arg;
+	pipe->remaining = limit;
+
+	// enough that neither side waits on the other for long
+	pipe->n_batches = 2 * (producers + consumers) + 1;
+	pipe->batches = malloc(sizeof(Batch) * pipe->n_batches);
+	pipe->idle = malloc(sizeof(Batch *) * pipe->n_batches);
+	pipe->queue = malloc(sizeof(Batch *) * pipe->n_batches);
+	assert(pipe->batches && pipe->idle && pipe->queue);
+
+	for (int i = 0; i < pipe->n_batches; i++) {
+		pipe->batches[i].busy = 0;
+		pipe->idle[i] = &pipe->batches[i];
+	}
+	pipe->n_idle = pipe->n_batches;
+	pipe->head = 0;
+	pipe->queued = 0;
+	pipe->seq = 0;
+
+	pthread_mutex_init(&pipe->lock, NULL);
+	pthread_cond_init(&pipe->filled, NULL);
+	pthread_cond_init(&pipe->freed, NULL);
+
+	pipe->quit = 0;
+	pipe->consumers = consumers;
+	pipe->threads = malloc(sizeof(pthread_t) * (consumers > 0 ? consumers : 1));
+	assert(pipe->threads);
+	for (int i = 0; i < consumers; i++) {
+		int err = pthread_create(&pipe->threads[i], NULL, pipeline_thread, pipe);
+		assert(!err);
+	}
+}
+
+void pipeline_free(Pipeline *pipe) {
+	pipeline_flush(pipe);
+
+	pthread_mutex_lock(&pipe->lock);
+	pipe->quit = 1;
+	pthread_cond_broadcast(&pipe->filled);
+	pthread_mutex_unlock(&pipe->lock);
+
+	for (int i = 0; i < pipe->consumers; i++) {
+		pthread_join(pipe->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pipe->lock);
+	pthread_cond_destroy(&pipe->filled);
+	pthread_cond_destroy(&pipe->freed);
+
+	free(pipe->threads);
+	free(pipe->batches);
+	free(pipe->idle);
+	free(pipe->queue);
+}
+
+int pipeline_more(Pipeline *pipe) {
+	return __atomic_load_n(&pipe->remaining, __ATOMIC_RELAXED) != 0;
+}
+
+int pipeline_take(Pipeline *pipe) {
+	long remaining = __atomic_load_n(&pipe->remaining, __ATOMIC_RELAXED);
+	while (remaining > 0) {
+		if (__atomic_compare_exchange_n(&pipe->remaining, &remaining, remaining - 1, 0,
+		                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			return 1;
+		}
+	}
+	return remaining < 0;
+}
+
+void pipeline_stop(Pipeline *pipe) {
+	__atomic_store_n(&pipe->remaining, 0, __ATOMIC_RELAXED);
+}
+
+Batch *pipeline_get(Pipeline *pipe) {
+	pthread_mutex_lock(&pipe->lock);
+	while (pipe->n_idle == 0) {
+		pthread_cond_wait(&pipe->freed, &pipe->lock);
+	}
+	Batch *batch = pipe->idle[--pipe->n_idle];
+	pthread_mutex_unlock(&pipe->lock);
+
+	batch->count = 0;
+	return batch;
+}
+
+void pipeline_put(Pipeline *pipe, Batch *batch) {
+	pthread_mutex_lock(&pipe->lock);
+	batch->seq = pipe->seq++;
+	batch->busy = 1;
+	if (pipe->consumers > 0) {
+		// there is always room, as there are only so many batches
+		pipe->queue[(pipe->head + pipe->queued++) % pipe->n_batches] = batch;
+		pthread_cond_signal(&pipe->filled);
+		pthread_mutex_unlock(&pipe->lock);
+		return;
+	}
+	pthread_mutex_unlock(&pipe->lock);
+
+	pipe->sink(pipe->arg, batch);
+	pipeline_done(pipe, batch);
+}
+
+void pipeline_flush(Pipeline *pipe) {
+	pthread_mutex_lock(&pipe->lock);
+	long seq = pipe->seq;
+	for (;;) {
+		int waiting = 0;
+		for (int i = 0; i < pipe->n_batches; i++) {
+			waiting |= pipe->batches[i].busy && pipe->batches[i].seq < seq;
+		}
+		if (!waiting) {
+			break;
+		}
+		pthread_cond_wait(&pipe->freed, &pipe->lock);
+	}
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+static void *pipeline_thread(void *arg) {
+	Pipeline *pipe = arg;
+
+	pthread_mutex_lock(&pipe->lock);
+	for (;;) {
+		while (!pipe->quit && pipe->queued == 0) {
+			pthread_cond_wait(&pipe->filled, &pipe->lock);
+		}
+		if (pipe->queued == 0) {
+			break;
+		}
+
+		Batch *batch = pipe->queue[pipe->head];
+		pipe->head = (pipe->head + 1) % pipe->n_batches;
+		pipe->queued--;
+		pthread_mutex_unlock(&pipe->lock);
+
+		pipe->sink(pipe->arg, batch);
+
+		pipeline_done(pipe, batch);
+		pthread_mutex_lock(&pipe->lock);
+	}
+	pthread_mutex_unlock(&pipe->lock);
+
+	return NULL;
+}
+
+// returns a consumed batch to be filled again
+static void pipeline_done(Pipeline *pipe, Batch *batch) {
+	pthread_mutex_lock(&pipe->lock);
+	batch->busy = 0;
+	pipe->idle[pipe->n_idle++] = batch;
+	pthread_cond_broadcast(&pipe->freed);
+	pthread_mutex_unlock(&pipe->lock);
+}
@@ -0,0 +1,67 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// candidates per batch, and the longest candidate a batch can hold
+#define BATCH_SIZE     256
+#define BATCH_WORD_MAX  16
+
+typedef struct {
+	char words[BATCH_SIZE * BATCH_WORD_MAX];
+	size_t len[BATCH_SIZE];
+	int count;
+
+	// order batches were handed over in, and whether a sink has yet to finish
+	long seq;
+	int busy;
+} Batch;
+
+// consumes a full batch of candidates
+typedef void (*Sink)(void *arg, Batch *batch);
+
+typedef struct {
+	Sink sink;
+	void *arg;
+
+	// candidates still wanted, or -1 for no limit
+	long remaining;
+
+	// every batch, the ones free to fill, and a ring of ones waiting on a sink
+	Batch *batches;
+	Batch **idle;
+	Batch **queue;
+	int n_batches, n_idle, head, queued;
+	long seq;
+
+	pthread_t *threads;
+	int consumers, quit;
+
+	pthread_mutex_t lock;
+	pthread_cond_t filled, freed;
+} Pipeline;
+
+// sets up a pipeline for producers filling batches and consumers threads
+// running sink over them. with no consumers the sink runs in the producer
+// handing over the batch, in order. limit caps the candidates taken, -1 for
+// no limit
+void pipeline_init(Pipeline *pipe, int producers, int consumers, long limit, Sink sink, void *arg);
+// waits for every batch to be consumed, then stops the consumers
+void pipeline_free(Pipeline *pipe);
+
+// whether the pipeline still wants candidates
+int pipeline_more(Pipeline *pipe);
+// takes one more candidate off the limit, returning 0 if there were none left
+int pipeline_take(Pipeline *pipe);
+// wants no more candidates, as if the limit had been reached
+void pipeline_stop(Pipeline *pipe);
+
+// gets an empty batch to fill, waiting for one to be freed if need be
+Batch *pipeline_get(Pipeline *pipe);
+// hands a filled (or final part filled) batch over to the sink
+void pipeline_put(Pipeline *pipe, Batch *batch);
+// waits until every batch handed over before the call has been consumed
+void pipeline_flush(Pipeline *pipe);
+
+#endif
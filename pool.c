@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+static void *pool_thread(void *arg);
+static void pool_work(Pool *pool, int worker);
+static int pool_take(Pool *pool, int worker, long *unit);
+
+// workers need to know who they are before the pool is fully built
+typedef struct {
+	Pool *pool;
+	int worker;
+} PoolStart;
+
+void pool_init(Pool *pool, int count) {
+	assert(count > 0);
+
+	pool->count = count;
+	pool->job = 0;
+	pool->busy = 0;
+	pool->quit = 0;
+
+	pool->queues = malloc(sizeof(PoolQueue) * count);
+	pool->threads = malloc(sizeof(pthread_t) * count);
+	assert(pool->queues && pool->threads);
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (int i = 0; i < count; i++) {
+		pthread_mutex_init(&pool->queues[i].lock, NULL);
+		pool->queues[i].next = pool->queues[i].end = 0;
+	}
+
+	// worker 0 is whoever calls pool_run
+	for (int i = 1; i < count; i++) {
+		PoolStart *start = malloc(sizeof(PoolStart));
+		assert(start);
+		start->pool = pool;
+		start->worker = i;
+		int err = pthread_create(&pool->threads[i], NULL, pool_thread, start);
+		assert(!err);
+	}
+}
+
+void pool_free(Pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 1; i < pool->count; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	for (int i = 0; i < pool->count; i++) {
+		pthread_mutex_destroy(&pool->queues[i].lock);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+
+	free(pool->queues);
+	free(pool->threads);
+}
+
+void pool_run(Pool *pool, long units, PoolTask task, void *arg) {
+	// deal the units out evenly, in order
+	for (int i = 0; i < pool->count; i++) {
+		PoolQueue *queue = &pool->queues[i];
+		pthread_mutex_lock(&queue->lock);
+		queue->next = units * i / pool->count;
+		queue->end = units * (i + 1) / pool->count;
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->busy = pool->count - 1;
+	pool->job++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	pool_work(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->busy > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_thread(void *arg) {
+	PoolStart *start = arg;
+	Pool *pool = start->pool;
+	int worker = start->worker;
+	free(start);
+
+	long job = 0;
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->quit && pool->job == job) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if (pool->quit) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		job = pool->job;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool_work(pool, worker);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->busy == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static void pool_work(Pool *pool, int worker) {
+	long unit;
+	while (pool_take(pool, worker, &unit)) {
+		pool->task(pool->arg, unit, worker);
+	}
+}
+
+static int pool_take(Pool *pool, int worker, long *unit) {
+	PoolQueue *own = &pool->queues[worker];
+
+	pthread_mutex_lock(&own->lock);
+	if (own->next < own->end) {
+		*unit = own->next++;
+		pthread_mutex_unlock(&own->lock);
+		return 1;
+	}
+	pthread_mutex_unlock(&own->lock);
+
+	// out of work, so steal the back half of someone else's
+	for (int i = 1; i < pool->count; i++) {
+		PoolQueue *victim = &pool->queues[(worker + i) % pool->count];
+
+		pthread_mutex_lock(&victim->lock);
+		long left = victim->end - victim->next;
+		if (left <= 0) {
+			pthread_mutex_unlock(&victim->lock);
+			continue;
+		}
+		long from = victim->end - (left + 1) / 2;
+		long to = victim->end;
+		victim->end = from;
+		pthread_mutex_unlock(&victim->lock);
+
+		pthread_mutex_lock(&own->lock);
+		own->next = from + 1;
+		own->end = to;
+		pthread_mutex_unlock(&own->lock);
+
+		*unit = from;
+		return 1;
+	}
+
+	return 0;
+}
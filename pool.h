@@ -0,0 +1,39 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+// runs one unit of a job on behalf of worker
+typedef void (*PoolTask)(void *arg, long unit, int worker);
+
+// the units a worker has yet to run, [next, end). thieves take from the end
+typedef struct {
+	pthread_mutex_t lock;
+	long next, end;
+} PoolQueue;
+
+typedef struct {
+	pthread_t *threads;
+	PoolQueue *queues;
+	int count;
+
+	// the job currently being run
+	PoolTask task;
+	void *arg;
+	long job;
+	int busy, quit;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start, done;
+} Pool;
+
+// starts a pool of count workers, the thread calling pool_run being one
+void pool_init(Pool *pool, int count);
+void pool_free(Pool *pool);
+
+// runs task on every unit in [0, units), returning once all are done. units
+// are dealt out in contiguous runs, and idle workers steal half of what is
+// left from a busy one. with one worker the units run in order
+void pool_run(Pool *pool, long units, PoolTask task, void *arg);
+
+#endif
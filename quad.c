@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "quad.h"
+
+#define QUAD_MAGIC "crackq41"
+#define FILENAME_MAX_LEN 256
+
+// a unit of work fixes the first two characters
+#define QUAD_UNITS     (QUAD_CHARS * QUAD_CHARS)
+#define QUAD_UNIT_SIZE (QUAD_WORDS / QUAD_UNITS)
+
+// the most target keys a lookup filters on before checking each
+#define QUAD_FILTER_BITS 20
+
+// what an index starts with, padded so entries stay aligned
+typedef struct {
+	char magic[8];
+	int32_t bits;
+	int32_t pad;
+	int64_t words;
+} QuadHeader;
+
+typedef struct {
+	int bits;
+	unsigned char *keys;
+} QuadBuild;
+
+typedef struct {
+	const Quad *quad;
+	const BYTE *digests;
+	int n;
+	// target keys, sorted, with the target each is for, and a bit for the
+	// low filter_bits of each
+	uint32_t *keys;
+	int *targets;
+	uint64_t *filter;
+	int filter_bits;
+	QuadFound found;
+	void *arg;
+	pthread_mutex_t lock;
+} QuadFind;
+
+static void quad_build_unit(void *arg, long unit, int worker);
+static void quad_find_unit(void *arg, long unit, int worker);
+static inline void quad_scan(QuadFind *find, long first, int bits);
+static void quad_word(long i, char *word);
+static inline uint32_t quad_key(const BYTE digest[], int bits);
+
+int quad_build(const char *filename, int bits, Pool *pool) {
+	assert(bits == 8 || bits == 16 || bits == 32);
+
+	QuadHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, QUAD_MAGIC, sizeof(header.magic));
+	header.bits = bits;
+	header.words = QUAD_WORDS;
+	size_t size = sizeof(header) + QUAD_WORDS * (bits / 8);
+
+	// built aside, so a run reading it never sees half an index
+	char tmp[FILENAME_MAX_LEN];
+	snprintf(tmp, FILENAME_MAX_LEN, "%s.%ld.tmp", filename, (long) getpid());
+	int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		unlink(tmp);
+		return -1;
+	}
+	unsigned char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		unlink(tmp);
+		return -1;
+	}
+
+	memcpy(map, &header, sizeof(header));
+	QuadBuild build = { bits, map + sizeof(header) };
+	pool_run(pool, QUAD_UNITS, quad_build_unit, &build);
+
+	int ok = msync(map, size, MS_SYNC) == 0;
+	munmap(map, size);
+	if (!ok || rename(tmp, filename) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+int quad_load(Quad *quad, const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+
+	QuadHeader header;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || read(fd, &header, sizeof(header)) != sizeof(header)
+	    || memcmp(header.magic, QUAD_MAGIC, sizeof(header.magic))
+	    || (header.bits != 8 && header.bits != 16 && header.bits != 32)
+	    || header.words != QUAD_WORDS
+	    || (size_t) st.st_size != sizeof(header) + QUAD_WORDS * (header.bits / 8)) {
+		close(fd);
+		return 0;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+
+	quad->bits = header.bits;
+	quad->map = map;
+	quad->map_size = st.st_size;
+	quad->keys = (unsigned char *) map + sizeof(header);
+
+	return 1;
+}
+
+void quad_free(Quad *quad) {
+	munmap(quad->map, quad->map_size);
+}
+
+void quad_find(const Quad *quad, const BYTE digests[], int n, QuadFound found, void *arg, Pool *pool) {
+	if (n == 0) {
+		return;
+	}
+
+	QuadFind find;
+	find.quad = quad;
+	find.digests = digests;
+	find.n = n;
+	find.found = found;
+	find.arg = arg;
+	pthread_mutex_init(&find.lock, NULL);
+
+	// keys sorted by insertion, there being only a handful of targets
+	find.keys = malloc(sizeof(uint32_t) * n);
+	find.targets = malloc(sizeof(int) * n);
+	assert(find.keys && find.targets);
+	for (int i = 0; i < n; i++) {
+		uint32_t key = quad_key(&digests[i * SHA256_BLOCK_SIZE], quad->bits);
+		int j = i;
+		for (; j > 0 && find.keys[j - 1] > key; j--) {
+			find.keys[j] = find.keys[j - 1];
+			find.targets[j] = find.targets[j - 1];
+		}
+		find.keys[j] = key;
+		find.targets[j] = i;
+	}
+
+	find.filter_bits = quad->bits < QUAD_FILTER_BITS ? quad->bits : QUAD_FILTER_BITS;
+	find.filter = calloc((1L << find.filter_bits) / 64 + 1, sizeof(uint64_t));
+	assert(find.filter);
+	for (int i = 0; i < n; i++) {
+		uint32_t low = find.keys[i] & ((1UL << find.filter_bits) - 1);
+		find.filter[low >> 6] |= 1ULL << (low & 63);
+	}
+
+	pool_run(pool, QUAD_UNITS, quad_find_unit, &find);
+
+	pthread_mutex_destroy(&find.lock);
+	free(find.keys);
+	free(find.targets);
+	free(find.filter);
+}
+
+static void quad_build_unit(void *arg, long unit, int worker) {
+	QuadBuild *build = arg;
+	char words[QUAD_CHARS * QUAD_LEN];
+	size_t len[QUAD_CHARS];
+	BYTE digests[QUAD_CHARS * SHA256_BLOCK_SIZE];
+
+	for (int i = 0; i < QUAD_CHARS; i++) {
+		len[i] = QUAD_LEN;
+	}
+
+	// a run of words differing in just the last character at a time
+	long first = unit * QUAD_UNIT_SIZE;
+	for (long run = first; run < first + QUAD_UNIT_SIZE; run += QUAD_CHARS) {
+		for (int i = 0; i < QUAD_CHARS; i++) {
+			quad_word(run + i, &words[i * QUAD_LEN]);
+		}
+		sha256_batch((BYTE *) words, QUAD_LEN, len, QUAD_CHARS, digests);
+
+		int bytes = build->bits / 8;
+		for (int i = 0; i < QUAD_CHARS; i++) {
+			memcpy(&build->keys[(run + i) * bytes], &digests[i * SHA256_BLOCK_SIZE], bytes);
+		}
+	}
+}
+
+static void quad_find_unit(void *arg, long unit, int worker) {
+	QuadFind *find = arg;
+
+	// a loop for each width, so each reads its entries as simply as it can
+	long first = unit * QUAD_UNIT_SIZE;
+	switch (find->quad->bits) {
+	case 8:
+		quad_scan(find, first, 8);
+		break;
+	case 16:
+		quad_scan(find, first, 16);
+		break;
+	default:
+		quad_scan(find, first, 32);
+	}
+}
+
+static inline void quad_scan(QuadFind *find, long first, int bits) {
+	const unsigned char *keys = find->quad->keys;
+	uint32_t mask = (1UL << find->filter_bits) - 1;
+
+	for (long i = first; i < first + QUAD_UNIT_SIZE; i++) {
+		uint32_t key = quad_key(&keys[i * (bits / 8)], bits), low = key & mask;
+		if (!(find->filter[low >> 6] >> (low & 63) & 1)) {
+			continue;
+		}
+
+		// the rare entry that gets this far is worth a proper look
+		for (int j = 0; j < find->n && find->keys[j] <= key; j++) {
+			if (find->keys[j] != key) {
+				continue;
+			}
+			char word[QUAD_LEN];
+			BYTE digest[SHA256_BLOCK_SIZE];
+			quad_word(i, word);
+			sha256_short((BYTE *) word, QUAD_LEN, digest);
+
+			int target = find->targets[j];
+			if (!memcmp(digest, &find->digests[target * SHA256_BLOCK_SIZE], SHA256_BLOCK_SIZE)) {
+				pthread_mutex_lock(&find->lock);
+				find->found(find->arg, target, word);
+				pthread_mutex_unlock(&find->lock);
+			}
+		}
+	}
+}
+
+// the i'th word, counting from the lowest printable character up
+static void quad_word(long i, char *word) {
+	for (int j = QUAD_LEN - 1; j >= 0; j--) {
+		word[j] = QUAD_CHAR_MIN + i % QUAD_CHARS;
+		i /= QUAD_CHARS;
+	}
+}
+
+// the first bits of a digest, or an entry holding them, read in whatever
+// order the machine reads them. only ever compared with each other
+static inline uint32_t quad_key(const BYTE digest[], int bits) {
+	uint32_t key = 0;
+	memcpy(&key, digest, bits / 8);
+	return key;
+}
@@ -0,0 +1,47 @@
+#ifndef QUAD_H
+#define QUAD_H
+
+#include <stddef.h>
+
+#include "sha256.h"
+#include "pool.h"
+
+// an index over the digest of every printable 4 character word. entry i is
+// the first bits of the digest of word i, counting in base QUAD_CHARS from
+// "    ", so the word is known from where its entry is and only the digest
+// needs storing. a lookup scans every entry, confirming any that match a
+// target with a full hash.
+//
+// memory, on disk and mapped, is QUAD_WORDS * bits / 8 bytes: about 81MB at
+// 8 bits, 163MB at 16 and 326MB at 32. fewer bits means more entries that
+// match by chance, each costing a hash to rule out: about 318,000 per
+// target at 8 bits, 1,243 at 16 and none to speak of at 32
+
+#define QUAD_LEN       4
+#define QUAD_CHAR_MIN 32
+#define QUAD_CHARS    95
+#define QUAD_WORDS    (95L * 95 * 95 * 95)
+
+typedef struct {
+	int bits;
+	const unsigned char *keys;
+
+	void *map;
+	size_t map_size;
+} Quad;
+
+// called with each target of a lookup found, and the word it is
+typedef void (*QuadFound)(void *arg, int target, const char *word);
+
+// builds an index keeping bits (8, 16 or 32) of each digest in filename,
+// across the pool's workers. returns -1 if it could not be written
+int quad_build(const char *filename, int bits, Pool *pool);
+// maps the index in filename, returning 0 if there is none
+int quad_load(Quad *quad, const char *filename);
+void quad_free(Quad *quad);
+
+// finds the word for each of n target digests there is one for, across the
+// pool's workers
+void quad_find(const Quad *quad, const BYTE digests[], int n, QuadFound found, void *arg, Pool *pool);
+
+#endif
@@ -0,0 +1,329 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "rules.h"
+
+#define GROWTH_FACTOR 2
+
+static int rule_line(Rules *rules, const char *p, const char *eol);
+static void rule_push(Rules *rules, int code, int a, int b);
+static int rule_pos(char c);
+static int rule_run(const Rules *rules, const RuleOp *op, char *word, int len, RuleEmit emit, void *arg);
+
+void rules_init(Rules *rules) {
+	rules->alloc = 64;
+	rules->ops = malloc(sizeof(RuleOp) * rules->alloc);
+	assert(rules->ops);
+	rules->n_ops = 0;
+	rules->count = 0;
+
+	memset(rules->n_subs, 0, sizeof(rules->n_subs));
+}
+
+void rules_free(Rules *rules) {
+	free(rules->ops);
+}
+
+int rules_compile(Rules *rules, const char *source) {
+	int line = 1;
+	for (const char *p = source; *p; line++) {
+		const char *eol = strchr(p, '\n');
+		if (!eol) {
+			eol = p + strlen(p);
+		}
+
+		if (!rule_line(rules, p, eol)) {
+			return line;
+		}
+
+		p = *eol ? eol + 1 : eol;
+	}
+
+	return 0;
+}
+
+int rules_load(Rules *rules, const char *filename) {
+	FILE *fp = fopen(filename, "rb");
+	if (!fp) {
+		return -1;
+	}
+
+	struct stat st;
+	stat(filename, &st);
+	long len = st.st_size;
+
+	char *source = malloc(sizeof(char) * (len + 1));
+	assert(source);
+	len = fread(source, sizeof(char), len, fp);
+	source[len] = '\0';
+	fclose(fp);
+
+	int err = rules_compile(rules, source);
+	free(source);
+
+	return err;
+}
+
+int rules_apply(const Rules *rules, const char *word, int len, RuleEmit emit, void *arg) {
+	len = len < RULE_WORD_MAX ? len : RULE_WORD_MAX;
+
+	const RuleOp *op = rules->ops;
+	for (int i = 0; i < rules->count; i++) {
+		char buf[RULE_WORD_MAX];
+		memcpy(buf, word, len);
+		if (!rule_run(rules, op, buf, len, emit, arg)) {
+			return 0;
+		}
+
+		// on to the next rule
+		while (op->code != RULE_END) {
+			op++;
+		}
+		op++;
+	}
+
+	return 1;
+}
+
+// compiles a line of a rule file, returning 0 if it is malformed
+static int rule_line(Rules *rules, const char *p, const char *eol) {
+	if (eol > p && eol[-1] == '\r') {
+		eol--;
+	}
+	if (p == eol || *p == '#') {
+		return 1;
+	}
+
+	// a line of the substitution table
+	if (*p == '=') {
+		int n = eol - p - 2;
+		if (n < 1 || n > RULE_SUBS_MAX) {
+			return 0;
+		}
+		unsigned char c = p[1];
+		memcpy(rules->subs[c], p + 2, n);
+		rules->n_subs[c] = n;
+		return 1;
+	}
+
+	int start = rules->n_ops;
+	for (; p < eol; p++) {
+		int left = eol - p - 1;
+		int n;
+
+		switch (*p) {
+		case ' ':
+		case '\t':
+			continue;
+		case ':':
+			rule_push(rules, RULE_NOP, 0, 0);
+			continue;
+		case 'l':
+			rule_push(rules, RULE_LOWER, 0, 0);
+			continue;
+		case 'u':
+			rule_push(rules, RULE_UPPER, 0, 0);
+			continue;
+		case 'c':
+			rule_push(rules, RULE_CAPITAL, 0, 0);
+			continue;
+		case 't':
+			rule_push(rules, RULE_TOGGLE_ALL, 0, 0);
+			continue;
+		case '[':
+			rule_push(rules, RULE_DELETE_FIRST, 0, 0);
+			continue;
+		case ']':
+			rule_push(rules, RULE_DELETE_LAST, 0, 0);
+			continue;
+		case '$':
+		case '^':
+			if (left < 1) {
+				break;
+			}
+			rule_push(rules, *p == '$' ? RULE_APPEND : RULE_PREPEND, p[1], 0);
+			p++;
+			continue;
+		case 's':
+			if (left < 2) {
+				break;
+			}
+			rule_push(rules, RULE_REPLACE, p[1], p[2]);
+			p += 2;
+			continue;
+		case 'T':
+		case '\'':
+		case '>':
+		case '<':
+		case '%':
+			if (left < 1 || (n = rule_pos(p[1])) < 0) {
+				break;
+			}
+			rule_push(rules, *p == 'T' ? RULE_TOGGLE : *p == '\'' ? RULE_TRUNCATE :
+			          *p == '>' ? RULE_LONGER : *p == '<' ? RULE_SHORTER : RULE_SUBS, n, 0);
+			p++;
+			continue;
+		}
+
+		// not an operation we know, or missing its arguments
+		rules->n_ops = start;
+		return 0;
+	}
+
+	// a line of nothing but space is as good as blank
+	if (rules->n_ops == start) {
+		return 1;
+	}
+
+	rule_push(rules, RULE_END, 0, 0);
+	rules->count++;
+	return 1;
+}
+
+static void rule_push(Rules *rules, int code, int a, int b) {
+	if (rules->n_ops >= rules->alloc) {
+		rules->alloc *= GROWTH_FACTOR;
+		rules->ops = realloc(rules->ops, sizeof(RuleOp) * rules->alloc);
+		assert(rules->ops);
+	}
+
+	RuleOp *op = &rules->ops[rules->n_ops++];
+	op->code = code;
+	op->a = a;
+	op->b = b;
+}
+
+static int rule_pos(char c) {
+	if ('0' <= c && c <= '9') {
+		return c - '0';
+	}
+	if ('A' <= c && c <= 'Z') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+#define IS_LOWER(C) ('a' <= (C) && (C) <= 'z')
+#define IS_UPPER(C) ('A' <= (C) && (C) <= 'Z')
+#define TOGGLE(C)   (IS_LOWER(C) || IS_UPPER(C) ? (C) ^ 0x20 : (C))
+
+// runs a rule from op over word, emitting what it makes. returns 0 if emit
+// asked to stop
+static int rule_run(const Rules *rules, const RuleOp *op, char *word, int len, RuleEmit emit, void *arg) {
+	for (;; op++) {
+		switch (op->code) {
+		case RULE_END:
+			return emit(arg, word, len);
+		case RULE_NOP:
+			break;
+		case RULE_LOWER:
+			for (int i = 0; i < len; i++) {
+				word[i] = IS_UPPER(word[i]) ? word[i] ^ 0x20 : word[i];
+			}
+			break;
+		case RULE_UPPER:
+			for (int i = 0; i < len; i++) {
+				word[i] = IS_LOWER(word[i]) ? word[i] ^ 0x20 : word[i];
+			}
+			break;
+		case RULE_CAPITAL:
+			for (int i = 0; i < len; i++) {
+				int upper = IS_UPPER(word[i]);
+				word[i] = (i == 0) != upper ? TOGGLE(word[i]) : word[i];
+			}
+			break;
+		case RULE_TOGGLE_ALL:
+			for (int i = 0; i < len; i++) {
+				word[i] = TOGGLE(word[i]);
+			}
+			break;
+		case RULE_TOGGLE:
+			if (op->a < len) {
+				word[op->a] = TOGGLE(word[op->a]);
+			}
+			break;
+		case RULE_APPEND:
+		case RULE_PREPEND:
+			if (len >= RULE_WORD_MAX) {
+				return 1;
+			}
+			if (op->code == RULE_PREPEND) {
+				memmove(word + 1, word, len);
+				word[0] = op->a;
+			} else {
+				word[len] = op->a;
+			}
+			len++;
+			break;
+		case RULE_REPLACE:
+			for (int i = 0; i < len; i++) {
+				word[i] = word[i] == op->a ? op->b : word[i];
+			}
+			break;
+		case RULE_DELETE_FIRST:
+			if (len > 0) {
+				memmove(word, word + 1, --len);
+			}
+			break;
+		case RULE_DELETE_LAST:
+			len -= len > 0;
+			break;
+		case RULE_TRUNCATE:
+			len = len < op->a ? len : op->a;
+			break;
+		case RULE_LONGER:
+			if (len <= op->a) {
+				return 1;
+			}
+			break;
+		case RULE_SHORTER:
+			if (len >= op->a) {
+				return 1;
+			}
+			break;
+		case RULE_SUBS: {
+			// the characters with substitutions, and which each is up to, 0
+			// being left as is. the choices count up like an odometer, in the
+			// same order as trying substitutions left to right would
+			int pos[RULE_WORD_MAX], choice[RULE_WORD_MAX], n = 0;
+			for (int i = 0; i < len; i++) {
+				if (rules->n_subs[(unsigned char) word[i]]) {
+					pos[n] = i;
+					choice[n++] = 0;
+				}
+			}
+
+			char orig[RULE_WORD_MAX], guess[RULE_WORD_MAX];
+			memcpy(orig, word, len);
+
+			int used = 0;
+			for (;;) {
+				// the rightmost choice that can move on, resetting those after
+				int i;
+				for (i = n - 1; i >= 0; i--) {
+					unsigned char c = orig[pos[i]];
+					if (choice[i] < rules->n_subs[c] && (choice[i] > 0 || used < op->a)) {
+						used += choice[i] == 0;
+						word[pos[i]] = rules->subs[c][choice[i]++];
+						break;
+					}
+					used -= choice[i] > 0;
+					choice[i] = 0;
+					word[pos[i]] = c;
+				}
+				if (i < 0) {
+					return 1;
+				}
+
+				memcpy(guess, word, len);
+				if (!rule_run(rules, op + 1, guess, len, emit, arg)) {
+					return 0;
+				}
+			}
+		}
+		}
+	}
+}
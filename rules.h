@@ -0,0 +1,60 @@
+#ifndef RULES_H
+#define RULES_H
+
+// rules mangle dictionary words into guesses. a rule file has one rule per
+// line, each a run of operations applied in turn. blank lines and lines
+// starting with # are skipped. N is a position or length, 0-9 then A-Z for
+// 10-35, and X and Y are single characters
+//
+//   :    do nothing            l    lowercase       u    uppercase
+//   c    capitalise            t    toggle case     TN   toggle case at N
+//   $X   append X              ^X   prepend X       sXY  replace X with Y
+//   [    delete first          ]    delete last     'N   truncate to N
+//   >N   reject unless longer than N                <N   reject unless shorter
+//   %N   every way of substituting between 1 and N characters, from the
+//        table built by lines of the form =XABC (X may become A, B or C)
+
+// longest word a rule works on, anything past it is cut off
+#define RULE_WORD_MAX 64
+// most substitutions one character can have
+#define RULE_SUBS_MAX  8
+
+typedef enum {
+	RULE_END, RULE_NOP, RULE_LOWER, RULE_UPPER, RULE_CAPITAL, RULE_TOGGLE_ALL,
+	RULE_TOGGLE, RULE_APPEND, RULE_PREPEND, RULE_REPLACE, RULE_DELETE_FIRST,
+	RULE_DELETE_LAST, RULE_TRUNCATE, RULE_LONGER, RULE_SHORTER, RULE_SUBS
+} RuleCode;
+
+// a compiled operation and its arguments
+typedef struct {
+	unsigned char code, a, b;
+} RuleOp;
+
+typedef struct {
+	// every rule's operations, each run ending in RULE_END
+	RuleOp *ops;
+	int n_ops, alloc;
+	int count;
+
+	// what each character may be substituted with
+	char subs[256][RULE_SUBS_MAX];
+	unsigned char n_subs[256];
+} Rules;
+
+// takes a guess made by a rule, returning 0 to stop applying rules
+typedef int (*RuleEmit)(void *arg, const char *word, int len);
+
+void rules_init(Rules *rules);
+void rules_free(Rules *rules);
+
+// compiles the rules in source, returning 0, or the line of the first rule
+// that could not be compiled
+int rules_compile(Rules *rules, const char *source);
+// compiles the rules in filename, returning -1 if it could not be read
+int rules_load(Rules *rules, const char *filename);
+
+// emits every guess the rules make from word, in order. returns 0 if emit
+// asked to stop
+int rules_apply(const Rules *rules, const char *word, int len, RuleEmit emit, void *arg);
+
+#endif
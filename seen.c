@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "seen.h"
+
+#define GROWTH_FACTOR 2
+
+#define SEEN_CHAR_MIN  32
+#define SEEN_CHARS     95
+#define SEEN_BLOCKS    (SEEN_BLOOM_BITS / 512)
+#define SEEN_PROBES     8
+// long enough that a run of guesses sharing a prefix keeps hitting the same
+// part of the prefix table
+#define SEEN_PREFIX_LEN 4
+
+static long seen_index(const char *word, int len);
+static uint64_t seen_hash(const char *word, int len);
+static int seen_bit(uint64_t *bits, long i, int set);
+static int seen_bloom(Seen *seen, uint64_t h, int set);
+
+void seen_init(Seen *seen) {
+	long shorts = 1, prefixes = 1;
+	for (int i = 0; i < SEEN_SHORT_LEN; i++) {
+		shorts *= SEEN_CHARS;
+	}
+	for (int i = 0; i < SEEN_PREFIX_LEN; i++) {
+		prefixes *= SEEN_CHARS;
+	}
+
+	seen->shorts = calloc(shorts / 64 + 1, sizeof(uint64_t));
+	seen->prefixes = calloc(prefixes / 64 + 1, sizeof(uint64_t));
+	seen->bloom = calloc(SEEN_BLOOM_BITS / 64, sizeof(uint64_t));
+	assert(seen->shorts && seen->prefixes && seen->bloom);
+	seen->added = 0;
+
+	seen->alloc = 4;
+	seen->masks = malloc(sizeof(SeenMask) * seen->alloc);
+	assert(seen->masks);
+	seen->n_masks = 0;
+}
+
+void seen_free(Seen *seen) {
+	free(seen->shorts);
+	free(seen->prefixes);
+	free(seen->bloom);
+	free(seen->masks);
+}
+
+void seen_add(Seen *seen, const char *word, int len) {
+	if (len == SEEN_SHORT_LEN) {
+		long i = seen_index(word, len);
+		if (i >= 0) {
+			seen_bit(seen->shorts, i, 1);
+		}
+		return;
+	}
+
+	// past this many, false positives would start to add up
+	if (__atomic_fetch_add(&seen->added, 1, __ATOMIC_RELAXED) >= SEEN_BLOOM_WORDS) {
+		return;
+	}
+
+	long prefix = len >= SEEN_PREFIX_LEN ? seen_index(word, SEEN_PREFIX_LEN) : -1;
+	if (prefix >= 0) {
+		seen_bit(seen->prefixes, prefix, 1);
+	}
+
+	seen_bloom(seen, seen_hash(word, len), 1);
+}
+
+int seen_has(Seen *seen, const char *word, int len) {
+	for (int m = 0; m < seen->n_masks; m++) {
+		SeenMask *mask = &seen->masks[m];
+		if (mask->len != len) {
+			continue;
+		}
+		int i = 0;
+		for (; i < len; i++) {
+			unsigned char c = word[i];
+			if (!(mask->allow[i][c >> 6] >> (c & 63) & 1)) {
+				break;
+			}
+		}
+		if (i == len) {
+			return 1;
+		}
+	}
+
+	if (len == SEEN_SHORT_LEN) {
+		long i = seen_index(word, len);
+		return i >= 0 && seen_bit(seen->shorts, i, 0);
+	}
+
+	long prefix = len >= SEEN_PREFIX_LEN ? seen_index(word, SEEN_PREFIX_LEN) : -1;
+	if (prefix >= 0 && !seen_bit(seen->prefixes, prefix, 0)) {
+		return 0;
+	}
+
+	return seen_bloom(seen, seen_hash(word, len), 0);
+}
+
+void seen_mask(Seen *seen, const Mask *mask) {
+	if (seen->n_masks >= seen->alloc) {
+		seen->alloc *= GROWTH_FACTOR;
+		seen->masks = realloc(seen->masks, sizeof(SeenMask) * seen->alloc);
+		assert(seen->masks);
+	}
+
+	SeenMask *allowed = &seen->masks[seen->n_masks++];
+	memset(allowed, 0, sizeof(SeenMask));
+	allowed->len = mask->len;
+	for (int i = 0; i < mask->len; i++) {
+		for (int j = 0; j < mask->radix[i]; j++) {
+			unsigned char c = mask->set[i][j];
+			allowed->allow[i][c >> 6] |= 1ULL << (c & 63);
+		}
+	}
+}
+
+// where a printable word sits among all those as long, -1 if not printable
+static long seen_index(const char *word, int len) {
+	long index = 0;
+	for (int i = 0; i < len; i++) {
+		int c = (unsigned char) word[i] - SEEN_CHAR_MIN;
+		if (c < 0 || c >= SEEN_CHARS) {
+			return -1;
+		}
+		index = index * SEEN_CHARS + c;
+	}
+	return index;
+}
+
+// 64 bit FNV-1a, then mixed so every bit depends on every character
+static uint64_t seen_hash(const char *word, int len) {
+	uint64_t h = 0xcbf29ce484222325ULL ^ len;
+	for (int i = 0; i < len; i++) {
+		h ^= (unsigned char) word[i];
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// checks a word's bits in the bloom filter, first setting them if set. the
+// block comes from the low bits of h and each probe from fresh high bits, as
+// probes stepped from one start repeat whenever two words share a start
+static int seen_bloom(Seen *seen, uint64_t h, int set) {
+	uint64_t *block = &seen->bloom[(h & (SEEN_BLOCKS - 1)) * 8];
+	uint64_t g = h;
+	for (int i = 0; i < SEEN_PROBES; i++) {
+		g *= 0x9e3779b97f4a7c15ULL;
+		if (!seen_bit(block, g >> 55, set)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// reads bit i, first setting it if set
+static int seen_bit(uint64_t *bits, long i, int set) {
+	uint64_t bit = 1ULL << (i & 63);
+	if (set) {
+		__atomic_fetch_or(&bits[i >> 6], bit, __ATOMIC_RELAXED);
+		return 1;
+	}
+	return (__atomic_load_n(&bits[i >> 6], __ATOMIC_RELAXED) & bit) != 0;
+}
@@ -0,0 +1,49 @@
+#ifndef SEEN_H
+#define SEEN_H
+
+#include <stdint.h>
+
+#include "mask.h"
+
+// remembers which guesses have already been hashed, so later phases can skip
+// them. words of SEEN_SHORT_LEN printable characters are tracked exactly,
+// other words in a bloom filter, so very rarely a word is thought seen when
+// it was not. whole masks that have been guessed are remembered exactly
+
+#define SEEN_SHORT_LEN 4
+// bloom filter size, and the most words it takes before it stops adding
+// more, keeping false positives below about one in a million
+#define SEEN_BLOOM_BITS  (1L << 28)
+#define SEEN_BLOOM_WORDS (SEEN_BLOOM_BITS / 48)
+
+// which characters a fully guessed mask allows at each position
+typedef struct {
+	int len;
+	uint64_t allow[MASK_LEN_MAX][4];
+} SeenMask;
+
+typedef struct {
+	// a bit for every printable word SEEN_SHORT_LEN long
+	uint64_t *shorts;
+	// a bit for every printable 4 character prefix of a word in the bloom
+	// filter, which rules most words out without touching it
+	uint64_t *prefixes;
+	// 512 bit blocks, each word setting bits in just one
+	uint64_t *bloom;
+	long added;
+
+	SeenMask *masks;
+	int n_masks, alloc;
+} Seen;
+
+void seen_init(Seen *seen);
+void seen_free(Seen *seen);
+
+// notes word as seen. safe to call from any thread
+void seen_add(Seen *seen, const char *word, int len);
+// whether word has been seen, or is in a mask already fully guessed
+int seen_has(Seen *seen, const char *word, int len);
+// notes every word mask makes as seen. not safe alongside seen_has
+void seen_mask(Seen *seen, const Mask *mask);
+
+#endif
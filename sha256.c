@@ -17,8 +17,15 @@
 
 /*************************** HEADER FILES ***************************/
 #include <stdlib.h>
+#include <stdio.h>
 #include <memory.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
@@ -42,24 +49,29 @@ static const WORD k[64] = {
 	0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
 };
 
+static const WORD iv[8] = {
+	0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19
+};
+
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+// Runs the compression function over one block of big endian words.
+static void sha256_compress_c(WORD state[], const WORD block[])
 {
-	WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
+	WORD a, b, c, d, e, f, g, h, i, t1, t2, m[64];
 
-	for (i = 0, j = 0; i < 16; ++i, j += 4)
-		m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+	for (i = 0; i < 16; ++i)
+		m[i] = block[i];
 	for ( ; i < 64; ++i)
 		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
 
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	for (i = 0; i < 64; ++i) {
 		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
@@ -74,14 +86,75 @@ void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
 		a = t1 + t2;
 	}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+#ifdef SHA256_X86
+// The same compression using the Intel SHA extensions, which keep the state
+// as ABEF/CDGH halves and run two rounds per sha256rnds2.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_compress_shani(WORD state[], const WORD block[])
+{
+	__m128i state0, state1, abef, cdgh, msg, tmp, w[4];
+	int i;
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+	abef = state0;
+	cdgh = state1;
+
+	for (i = 0; i < 4; ++i)
+		w[i] = _mm_loadu_si128((const __m128i *) &block[i * 4]);
+
+	// four rounds a step, w[i % 4] holding the schedule words for step i
+	for (i = 0; i < 16; ++i) {
+		msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *) &k[i * 4]));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		if (i >= 3 && i < 15) {
+			tmp = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+			w[(i + 1) & 3] = _mm_add_epi32(w[(i + 1) & 3], tmp);
+			w[(i + 1) & 3] = _mm_sha256msg2_epu32(w[(i + 1) & 3], w[i & 3]);
+		}
+		msg = _mm_shuffle_epi32(msg, 0x0e);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		if (i >= 1 && i < 13)
+			w[(i - 1) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+	}
+
+	state0 = _mm_add_epi32(state0, abef);
+	state1 = _mm_add_epi32(state1, cdgh);
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+	_mm_storeu_si128((__m128i *) &state[0], state0);
+	_mm_storeu_si128((__m128i *) &state[4], state1);
+}
+#endif // SHA256_X86
+
+// Picked once at startup by sha256_dispatch.
+static void (*sha256_compress)(WORD state[], const WORD block[]) = sha256_compress_c;
+static int sha256_shani = 0;
+static int sha256_width = 1;
+
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+{
+	WORD i, j, m[16];
+
+	for (i = 0, j = 0; i < 16; ++i, j += 4)
+		m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+
+	sha256_compress(ctx->state, m);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -158,3 +231,330 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 		hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
 	}
 }
+
+/*********************** BATCH FUNCTIONS ***********************/
+// Builds the padded block of a message of at most SHA256_SHORT_MAX bytes
+// directly as big endian words.
+static void sha256_pad(const BYTE data[], size_t len, WORD m[])
+{
+	size_t i;
+
+	memset(m, 0, sizeof(WORD) * 16);
+	for (i = 0; i < len; ++i)
+		m[i >> 2] |= (WORD) data[i] << (24 - (i & 3) * 8);
+	m[len >> 2] |= (WORD) 0x80 << (24 - (len & 3) * 8);
+	m[15] = len * 8;
+}
+
+static void sha256_digest(const WORD state[], BYTE hash[])
+{
+	int i;
+
+	for (i = 0; i < 8; ++i) {
+		hash[i * 4]     = state[i] >> 24;
+		hash[i * 4 + 1] = state[i] >> 16;
+		hash[i * 4 + 2] = state[i] >> 8;
+		hash[i * 4 + 3] = state[i];
+	}
+}
+
+#ifdef SHA256_X86
+// SSE2: 4 lanes of 32 bits
+#define X4_ADD(x,y)    _mm_add_epi32((x),(y))
+#define X4_XOR(x,y)    _mm_xor_si128((x),(y))
+#define X4_AND(x,y)    _mm_and_si128((x),(y))
+#define X4_ROTR(x,n)   _mm_or_si128(_mm_srli_epi32((x),(n)), _mm_slli_epi32((x),32-(n)))
+#define X4_CH(x,y,z)   X4_XOR(X4_AND((x),(y)), _mm_andnot_si128((x),(z)))
+#define X4_MAJ(x,y,z)  X4_XOR(X4_XOR(X4_AND((x),(y)), X4_AND((x),(z))), X4_AND((y),(z)))
+#define X4_EP0(x)      X4_XOR(X4_XOR(X4_ROTR(x,2), X4_ROTR(x,13)), X4_ROTR(x,22))
+#define X4_EP1(x)      X4_XOR(X4_XOR(X4_ROTR(x,6), X4_ROTR(x,11)), X4_ROTR(x,25))
+#define X4_SIG0(x)     X4_XOR(X4_XOR(X4_ROTR(x,7), X4_ROTR(x,18)), _mm_srli_epi32((x),3))
+#define X4_SIG1(x)     X4_XOR(X4_XOR(X4_ROTR(x,17), X4_ROTR(x,19)), _mm_srli_epi32((x),10))
+
+__attribute__((target("sse2")))
+// Runs the first rounds rounds over the lanes, giving the digest state when
+// that is all 64 and the raw working variables otherwise.
+static void sha256_x4(WORD m[][16], WORD out[][8], int rounds)
+{
+	__m128i a, b, c, d, e, f, g, h, t1, t2, w[64];
+	WORD lane[4];
+	int i, l;
+
+	for (i = 0; i < 16; ++i)
+		w[i] = _mm_set_epi32(m[3][i], m[2][i], m[1][i], m[0][i]);
+	for ( ; i < rounds; ++i)
+		w[i] = X4_ADD(X4_ADD(X4_SIG1(w[i - 2]), w[i - 7]), X4_ADD(X4_SIG0(w[i - 15]), w[i - 16]));
+
+	a = _mm_set1_epi32(iv[0]);
+	b = _mm_set1_epi32(iv[1]);
+	c = _mm_set1_epi32(iv[2]);
+	d = _mm_set1_epi32(iv[3]);
+	e = _mm_set1_epi32(iv[4]);
+	f = _mm_set1_epi32(iv[5]);
+	g = _mm_set1_epi32(iv[6]);
+	h = _mm_set1_epi32(iv[7]);
+
+	for (i = 0; i < rounds; ++i) {
+		t1 = X4_ADD(X4_ADD(h, X4_EP1(e)), X4_ADD(X4_CH(e,f,g), X4_ADD(_mm_set1_epi32(k[i]), w[i])));
+		t2 = X4_ADD(X4_EP0(a), X4_MAJ(a,b,c));
+		h = g;
+		g = f;
+		f = e;
+		e = X4_ADD(d, t1);
+		d = c;
+		c = b;
+		b = a;
+		a = X4_ADD(t1, t2);
+	}
+
+	w[0] = a; w[1] = b; w[2] = c; w[3] = d;
+	w[4] = e; w[5] = f; w[6] = g; w[7] = h;
+	for (i = 0; i < 8; ++i) {
+		_mm_storeu_si128((__m128i *) lane, w[i]);
+		for (l = 0; l < 4; ++l)
+			out[l][i] = lane[l] + (rounds == 64 ? iv[i] : 0);
+	}
+}
+
+// AVX2: 8 lanes of 32 bits
+#define X8_ADD(x,y)    _mm256_add_epi32((x),(y))
+#define X8_XOR(x,y)    _mm256_xor_si256((x),(y))
+#define X8_AND(x,y)    _mm256_and_si256((x),(y))
+#define X8_ROTR(x,n)   _mm256_or_si256(_mm256_srli_epi32((x),(n)), _mm256_slli_epi32((x),32-(n)))
+#define X8_CH(x,y,z)   X8_XOR(X8_AND((x),(y)), _mm256_andnot_si256((x),(z)))
+#define X8_MAJ(x,y,z)  X8_XOR(X8_XOR(X8_AND((x),(y)), X8_AND((x),(z))), X8_AND((y),(z)))
+#define X8_EP0(x)      X8_XOR(X8_XOR(X8_ROTR(x,2), X8_ROTR(x,13)), X8_ROTR(x,22))
+#define X8_EP1(x)      X8_XOR(X8_XOR(X8_ROTR(x,6), X8_ROTR(x,11)), X8_ROTR(x,25))
+#define X8_SIG0(x)     X8_XOR(X8_XOR(X8_ROTR(x,7), X8_ROTR(x,18)), _mm256_srli_epi32((x),3))
+#define X8_SIG1(x)     X8_XOR(X8_XOR(X8_ROTR(x,17), X8_ROTR(x,19)), _mm256_srli_epi32((x),10))
+
+__attribute__((target("avx2")))
+static void sha256_x8(WORD m[][16], WORD out[][8], int rounds)
+{
+	__m256i a, b, c, d, e, f, g, h, t1, t2, w[64];
+	WORD lane[8];
+	int i, l;
+
+	for (i = 0; i < 16; ++i)
+		w[i] = _mm256_set_epi32(m[7][i], m[6][i], m[5][i], m[4][i],
+		                        m[3][i], m[2][i], m[1][i], m[0][i]);
+	for ( ; i < rounds; ++i)
+		w[i] = X8_ADD(X8_ADD(X8_SIG1(w[i - 2]), w[i - 7]), X8_ADD(X8_SIG0(w[i - 15]), w[i - 16]));
+
+	a = _mm256_set1_epi32(iv[0]);
+	b = _mm256_set1_epi32(iv[1]);
+	c = _mm256_set1_epi32(iv[2]);
+	d = _mm256_set1_epi32(iv[3]);
+	e = _mm256_set1_epi32(iv[4]);
+	f = _mm256_set1_epi32(iv[5]);
+	g = _mm256_set1_epi32(iv[6]);
+	h = _mm256_set1_epi32(iv[7]);
+
+	for (i = 0; i < rounds; ++i) {
+		t1 = X8_ADD(X8_ADD(h, X8_EP1(e)), X8_ADD(X8_CH(e,f,g), X8_ADD(_mm256_set1_epi32(k[i]), w[i])));
+		t2 = X8_ADD(X8_EP0(a), X8_MAJ(a,b,c));
+		h = g;
+		g = f;
+		f = e;
+		e = X8_ADD(d, t1);
+		d = c;
+		c = b;
+		b = a;
+		a = X8_ADD(t1, t2);
+	}
+
+	w[0] = a; w[1] = b; w[2] = c; w[3] = d;
+	w[4] = e; w[5] = f; w[6] = g; w[7] = h;
+	for (i = 0; i < 8; ++i) {
+		_mm256_storeu_si256((__m256i *) lane, w[i]);
+		for (l = 0; l < 8; ++l)
+			out[l][i] = lane[l] + (rounds == 64 ? iv[i] : 0);
+	}
+}
+#endif // SHA256_X86
+
+void sha256_short(const BYTE msg[], size_t len, BYTE hash[])
+{
+	WORD m[16], state[8];
+	SHA256_CTX ctx;
+
+	if (len > SHA256_SHORT_MAX) {
+		sha256_init(&ctx);
+		sha256_update(&ctx, msg, len);
+		sha256_final(&ctx, hash);
+		return;
+	}
+
+	sha256_pad(msg, len, m);
+	memcpy(state, iv, sizeof(state));
+	sha256_compress(state, m);
+	sha256_digest(state, hash);
+}
+
+WORD sha256_early_target(const BYTE hash[])
+{
+	// after the last round h holds what e was SHA256_EARLY_ROUNDS rounds in,
+	// and the final addition of the initial state is easily undone
+	WORD h = (hash[28] << 24) | (hash[29] << 16) | (hash[30] << 8) | hash[31];
+
+	return h - iv[7];
+}
+
+WORD sha256_short_early(const BYTE msg[], size_t len)
+{
+	WORD a, b, c, d, e, f, g, h, i, t1, t2, m[SHA256_EARLY_ROUNDS];
+	BYTE hash[SHA256_BLOCK_SIZE];
+
+	// a message spanning blocks has nothing to stop early on, and all 64
+	// rounds in hardware beat 61 in software
+	if (len > SHA256_SHORT_MAX || sha256_shani) {
+		sha256_short(msg, len, hash);
+		return sha256_early_target(hash);
+	}
+
+	sha256_pad(msg, len, m);
+	for (i = 16; i < SHA256_EARLY_ROUNDS; ++i)
+		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+	a = iv[0];
+	b = iv[1];
+	c = iv[2];
+	d = iv[3];
+	e = iv[4];
+	f = iv[5];
+	g = iv[6];
+	h = iv[7];
+
+	for (i = 0; i < SHA256_EARLY_ROUNDS; ++i) {
+		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+		t2 = EP0(a) + MAJ(a,b,c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	return e;
+}
+
+// Checks the compression picked for this CPU against the portable one over
+// a spread of blocks and states.
+static int sha256_self_test(void)
+{
+	WORD block[16], expect[8], got[8];
+	int i, j;
+
+	for (i = 0; i < 64; ++i) {
+		for (j = 0; j < 16; ++j)
+			block[j] = k[(i + j * 7) & 63] ^ (i * 0x01010101u);
+		for (j = 0; j < 8; ++j)
+			expect[j] = got[j] = i ? k[(i * 3 + j) & 63] : iv[j];
+
+		sha256_compress_c(expect, block);
+		sha256_compress(got, block);
+		if (memcmp(expect, got, sizeof(expect)))
+			return 0;
+	}
+
+	return 1;
+}
+
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+static void sha256_dispatch(void)
+{
+#ifdef SHA256_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		sha256_width = 8;
+	else if (__builtin_cpu_supports("sse2"))
+		sha256_width = 4;
+
+	// the SHA extensions are reported in CPUID leaf 7
+	unsigned int eax, ebx, ecx, edx;
+	if (__builtin_cpu_supports("sse4.1") && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+	    && (ebx & bit_SHA)) {
+		sha256_compress = sha256_compress_shani;
+		sha256_shani = 1;
+		if (!sha256_self_test()) {
+			fprintf(stderr, "sha256: SHA-NI self test failed, using C\n");
+			sha256_compress = sha256_compress_c;
+			sha256_shani = 0;
+		}
+	}
+#endif
+}
+
+int sha256_lanes(void)
+{
+	return sha256_width;
+}
+
+// Runs the first used padded blocks in m through the vector lanes, writing
+// digests to hash, or early reject words to early if hash is NULL.
+static void sha256_lanes_run(WORD m[][16], const size_t idx[], int used, BYTE hash[], WORD early[])
+{
+	WORD out[SHA256_LANES_MAX][8];
+	int lanes = sha256_lanes(), rounds = hash ? 64 : SHA256_EARLY_ROUNDS, l;
+
+	// pad out a partial group by repeating the first message
+	for (l = used; l < lanes; ++l)
+		memcpy(m[l], m[0], sizeof(m[0]));
+#ifdef SHA256_X86
+	if (lanes == 8)
+		sha256_x8(m, out, rounds);
+	else
+		sha256_x4(m, out, rounds);
+#endif
+	for (l = 0; l < used; ++l) {
+		if (hash)
+			sha256_digest(out[l], &hash[idx[l] * SHA256_BLOCK_SIZE]);
+		else
+			early[idx[l]] = out[l][4];
+	}
+}
+
+static void sha256_batch_run(const BYTE data[], size_t stride, const size_t len[], size_t n,
+                             BYTE hash[], WORD early[])
+{
+	WORD m[SHA256_LANES_MAX][16];
+	size_t idx[SHA256_LANES_MAX], i;
+	int lanes = sha256_lanes(), used = 0;
+
+	for (i = 0; i < n; ++i) {
+		// long messages and CPUs without vector units take the one at a time
+		// path. eight lanes keep up with SHA-NI, and beat it stopping early
+		if (lanes == 1 || len[i] > SHA256_SHORT_MAX) {
+			if (hash)
+				sha256_short(&data[i * stride], len[i], &hash[i * SHA256_BLOCK_SIZE]);
+			else
+				early[i] = sha256_short_early(&data[i * stride], len[i]);
+			continue;
+		}
+
+		sha256_pad(&data[i * stride], len[i], m[used]);
+		idx[used++] = i;
+		if (used == lanes) {
+			sha256_lanes_run(m, idx, used, hash, early);
+			used = 0;
+		}
+	}
+
+	if (used > 0)
+		sha256_lanes_run(m, idx, used, hash, early);
+}
+
+void sha256_batch(const BYTE data[], size_t stride, const size_t len[], size_t n, BYTE hash[])
+{
+	sha256_batch_run(data, stride, len, n, hash, NULL);
+}
+
+void sha256_batch_early(const BYTE data[], size_t stride, const size_t len[], size_t n, WORD early[])
+{
+	sha256_batch_run(data, stride, len, n, NULL, early);
+}
@@ -14,6 +14,9 @@
 
 /****************************** MACROS ******************************/
 #define SHA256_BLOCK_SIZE 32            // SHA256 outputs a 32 byte digest
+#define SHA256_SHORT_MAX  55            // Longest message that pads into one block
+#define SHA256_LANES_MAX  8             // Most messages hashed together by sha256_batch
+#define SHA256_EARLY_ROUNDS 61          // Rounds run before an early reject check
 
 /**************************** DATA TYPES ****************************/
 typedef unsigned char BYTE;             // 8-bit byte
@@ -31,4 +34,26 @@ void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
 
+// Hashes a message of at most SHA256_SHORT_MAX bytes in a single transform,
+// building the padded block directly. Longer messages take the usual path.
+void sha256_short(const BYTE msg[], size_t len, BYTE hash[]);
+
+// Recovers, from a digest, the value of e after SHA256_EARLY_ROUNDS rounds by
+// undoing the final additions and the last rounds of the compression.
+WORD sha256_early_target(const BYTE hash[]);
+// Runs only SHA256_EARLY_ROUNDS rounds over a short message and returns e. This
+// equals sha256_early_target of the message's digest, so a mismatch against a
+// target's value rules the message out without finishing the hash.
+WORD sha256_short_early(const BYTE msg[], size_t len);
+
+// Hashes n independent messages, message i starting at data + i * stride with
+// length len[i], writing digest i to hash + i * SHA256_BLOCK_SIZE. Messages of
+// at most SHA256_SHORT_MAX bytes go through SSE2/AVX2 lanes when the CPU has them.
+void sha256_batch(const BYTE data[], size_t stride, const size_t len[], size_t n, BYTE hash[]);
+// As sha256_batch, but writes each message's sha256_short_early word to
+// early[i] instead of its digest.
+void sha256_batch_early(const BYTE data[], size_t stride, const size_t len[], size_t n, WORD early[]);
+// Number of messages the batch kernel hashes per call on this CPU (1, 4 or 8).
+int sha256_lanes(void);
+
 #endif // SHA256_H
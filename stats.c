@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+#define GROWTH_FACTOR 2
+
+static void *stats_thread(void *arg);
+static double stats_now(void);
+static long stats_guesses(Stats *stats);
+static void stats_write_name(FILE *fp, const char *name);
+
+void stats_init(Stats *stats, int workers) {
+	stats->slots = calloc(workers, sizeof(StatsSlot));
+	assert(stats->slots);
+	stats->workers = workers;
+
+	stats->name[0] = '\0';
+	stats->running = 0;
+	stats->units = stats->done = 0;
+	stats->keyspace = 0;
+	stats->base = stats->hashes = stats->hits = 0;
+	stats->started = stats->began = stats_now();
+
+	stats->alloc = 16;
+	stats->phases = malloc(sizeof(StatsPhase) * stats->alloc);
+	assert(stats->phases);
+	stats->n_phases = 0;
+
+	stats->interval = 0;
+	stats->stop = 0;
+	pthread_mutex_init(&stats->lock, NULL);
+	pthread_cond_init(&stats->wake, NULL);
+}
+
+void stats_free(Stats *stats) {
+	if (stats->interval > 0) {
+		pthread_mutex_lock(&stats->lock);
+		stats->stop = 1;
+		pthread_cond_signal(&stats->wake);
+		pthread_mutex_unlock(&stats->lock);
+		pthread_join(stats->thread, NULL);
+	}
+
+	pthread_mutex_destroy(&stats->lock);
+	pthread_cond_destroy(&stats->wake);
+	free(stats->phases);
+	free(stats->slots);
+}
+
+void stats_start(Stats *stats, int interval) {
+	stats->interval = interval;
+	int err = pthread_create(&stats->thread, NULL, stats_thread, stats);
+	assert(!err);
+}
+
+void stats_phase(Stats *stats, const char *name, long units, unsigned long long keyspace) {
+	pthread_mutex_lock(&stats->lock);
+	snprintf(stats->name, STATS_NAME_MAX, "%s", name);
+	stats->running = 1;
+	stats->units = units;
+	stats->keyspace = keyspace;
+	stats->base = stats_guesses(stats);
+	stats->started = stats_now();
+	__atomic_store_n(&stats->done, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&stats->hashes, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&stats->hits, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_unit(Stats *stats) {
+	__atomic_fetch_add(&stats->done, 1, __ATOMIC_RELAXED);
+}
+
+void stats_hashed(Stats *stats, long n) {
+	__atomic_fetch_add(&stats->hashes, n, __ATOMIC_RELAXED);
+}
+
+void stats_hit(Stats *stats) {
+	__atomic_fetch_add(&stats->hits, 1, __ATOMIC_RELAXED);
+}
+
+void stats_end(Stats *stats) {
+	if (stats->interval > 0) {
+		stats_report(stats, stderr);
+	}
+
+	pthread_mutex_lock(&stats->lock);
+	if (stats->n_phases >= stats->alloc) {
+		stats->alloc *= GROWTH_FACTOR;
+		stats->phases = realloc(stats->phases, sizeof(StatsPhase) * stats->alloc);
+		assert(stats->phases);
+	}
+
+	StatsPhase *phase = &stats->phases[stats->n_phases++];
+	strcpy(phase->name, stats->name);
+	phase->guesses = stats_guesses(stats) - stats->base;
+	phase->hashes = __atomic_load_n(&stats->hashes, __ATOMIC_RELAXED);
+	phase->hits = __atomic_load_n(&stats->hits, __ATOMIC_RELAXED);
+	phase->seconds = stats_now() - stats->started;
+	stats->running = 0;
+	pthread_mutex_unlock(&stats->lock);
+}
+
+// e.g. "mask ?l?l?l?l?l?l: 1843200 guesses, 1843200 hashes, 0 hits, 2.41M/s,
+// 0.6% in 0:00:00, eta 0:02:07"
+void stats_report(Stats *stats, FILE *fp) {
+	pthread_mutex_lock(&stats->lock);
+	if (!stats->running) {
+		pthread_mutex_unlock(&stats->lock);
+		return;
+	}
+
+	double seconds = stats_now() - stats->started;
+	long guesses = stats_guesses(stats) - stats->base;
+	long hashes = __atomic_load_n(&stats->hashes, __ATOMIC_RELAXED);
+	long hits = __atomic_load_n(&stats->hits, __ATOMIC_RELAXED);
+	long done = __atomic_load_n(&stats->done, __ATOMIC_RELAXED);
+
+	// how far through, by guesses if the phase knows how many it makes,
+	// else by units, which are rougher
+	double part;
+	if (stats->keyspace > 0) {
+		part = (double) guesses / stats->keyspace;
+	} else {
+		part = stats->units > 0 ? (double) done / stats->units : 1;
+	}
+	part = part < 1 ? part : 1;
+	long eta = part > 0 ? (long) (seconds * (1 - part) / part) : -1;
+	long elapsed = seconds;
+
+	fprintf(fp, "%s: %ld guesses, %ld hashes, %ld hits, %.2fM/s, %.1f%% in %ld:%02ld:%02ld, ",
+	        stats->name, guesses, hashes, hits, seconds > 0 ? guesses / seconds / 1e6 : 0,
+	        100 * part, elapsed / 3600, elapsed / 60 % 60, elapsed % 60);
+	if (eta >= 0) {
+		fprintf(fp, "eta %ld:%02ld:%02ld\n", eta / 3600, eta / 60 % 60, eta % 60);
+	} else {
+		fprintf(fp, "eta unknown\n");
+	}
+	fflush(fp);
+	pthread_mutex_unlock(&stats->lock);
+}
+
+int stats_json(Stats *stats, const char *filename) {
+	FILE *fp = strcmp(filename, "-") ? fopen(filename, "w") : stderr;
+	if (!fp) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&stats->lock);
+	long guesses = 0, hashes = 0, hits = 0;
+	fprintf(fp, "{\"phases\": [");
+	for (int i = 0; i < stats->n_phases; i++) {
+		StatsPhase *phase = &stats->phases[i];
+		fprintf(fp, "%s\n  {\"name\": ", i ? "," : "");
+		stats_write_name(fp, phase->name);
+		fprintf(fp, ", \"guesses\": %ld, \"hashes\": %ld, \"hits\": %ld, \"seconds\": %.3f, "
+		        "\"guesses_per_s\": %.0f}", phase->guesses, phase->hashes, phase->hits,
+		        phase->seconds, phase->seconds > 0 ? phase->guesses / phase->seconds : 0);
+		guesses += phase->guesses;
+		hashes += phase->hashes;
+		hits += phase->hits;
+	}
+	fprintf(fp, "\n], \"guesses\": %ld, \"hashes\": %ld, \"hits\": %ld, \"seconds\": %.3f}\n",
+	        guesses, hashes, hits, stats_now() - stats->began);
+	pthread_mutex_unlock(&stats->lock);
+
+	if (fp == stderr) {
+		fflush(fp);
+		return 0;
+	}
+	return fclose(fp) ? -1 : 0;
+}
+
+static void *stats_thread(void *arg) {
+	Stats *stats = arg;
+
+	pthread_mutex_lock(&stats->lock);
+	while (!stats->stop) {
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += stats->interval;
+
+		pthread_cond_timedwait(&stats->wake, &stats->lock, &until);
+		if (!stats->stop) {
+			pthread_mutex_unlock(&stats->lock);
+			stats_report(stats, stderr);
+			pthread_mutex_lock(&stats->lock);
+		}
+	}
+	pthread_mutex_unlock(&stats->lock);
+
+	return NULL;
+}
+
+static double stats_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// every worker's guesses so far. each slot is only written by its worker
+static long stats_guesses(Stats *stats) {
+	long guesses = 0;
+	for (int i = 0; i < stats->workers; i++) {
+		guesses += __atomic_load_n(&stats->slots[i].guesses, __ATOMIC_RELAXED);
+	}
+	return guesses;
+}
+
+// masks can have quotes and backslashes in them
+static void stats_write_name(FILE *fp, const char *name) {
+	fputc('"', fp);
+	for (; *name; name++) {
+		if (*name == '"' || *name == '\\') {
+			fputc('\\', fp);
+		}
+		fputc(*name, fp);
+	}
+	fputc('"', fp);
+}
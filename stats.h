@@ -0,0 +1,76 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// counts of what each phase of a run did, reported as it goes and kept for
+// a summary at the end
+
+#define STATS_NAME_MAX 64
+#define STATS_LINE     64
+
+// a worker's guesses so far, on a cache line of its own so workers counting
+// never contend
+typedef struct {
+	long guesses;
+	char pad[STATS_LINE - sizeof(long)];
+} StatsSlot;
+
+// what a phase did, once it is over
+typedef struct {
+	char name[STATS_NAME_MAX];
+	long guesses, hashes, hits;
+	double seconds;
+} StatsPhase;
+
+typedef struct {
+	StatsSlot *slots;
+	int workers;
+
+	// the phase under way. guesses are what the slots have gained since it
+	// started, the rest are added to a batch or unit at a time
+	char name[STATS_NAME_MAX];
+	int running;
+	long units, done;
+	unsigned long long keyspace;
+	long base, hashes, hits;
+	double started;
+
+	StatsPhase *phases;
+	int n_phases, alloc;
+	double began;
+
+	int interval, stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} Stats;
+
+// sets up counting for workers, each adding to its own slot
+void stats_init(Stats *stats, int workers);
+// stops the reporter, if there is one
+void stats_free(Stats *stats);
+
+// reports the phase under way to stderr every interval seconds until
+// stats_free
+void stats_start(Stats *stats, int interval);
+
+// starts a phase of units, making keyspace guesses if that is known, else 0
+void stats_phase(Stats *stats, const char *name, long units, unsigned long long keyspace);
+// notes a unit of the phase is done
+void stats_unit(Stats *stats);
+// notes n guesses have been hashed
+void stats_hashed(Stats *stats, long n);
+// notes a target has been cracked
+void stats_hit(Stats *stats);
+// ends the phase under way, keeping what it did
+void stats_end(Stats *stats);
+
+// writes a line on the phase under way to fp
+void stats_report(Stats *stats, FILE *fp);
+// writes every phase so far to filename as JSON, returning -1 if it could
+// not be written
+int stats_json(Stats *stats, const char *filename);
+
+#endif